@@ -0,0 +1,478 @@
+/*
+ * Copyright (c) 2020 Tobias Kortkamp <t@tobik.me>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION
+ * OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include "config.h"
+
+#if HAVE_ERR
+# include <err.h>
+#endif
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "default_gestures.h"
+#include "gestures.h"
+#include "library.h"
+#include "matcher.h"
+#include "stroke.h"
+#include "timing.h"
+
+#define NSTROKES	256
+#define ROUNDS		20
+
+// A stroke as it was captured, before stroke_finish()
+struct sample {
+	char *name;
+	size_t n;
+	double *x;
+	double *y;
+};
+
+static struct sample *corpus;
+static size_t ncorpus;
+static struct stroke strokes[NSTROKES];
+
+static uint64_t
+next_random(void)
+{
+	static uint64_t state = 0x2545f4914f6cdd1dULL;
+
+	// xorshift64, for strokes that are the same on every run
+	state ^= state << 13;
+	state ^= state >> 7;
+	state ^= state << 17;
+	return state;
+}
+
+static double
+jitter(double amount)
+{
+	return ((next_random() >> 11) / 9007199254740992.0 - 0.5) * amount;
+}
+
+static struct sample *
+add_sample(const char *name)
+{
+	struct sample *sample;
+
+	corpus = reallocarray(corpus, ncorpus + 1, sizeof(struct sample));
+	if (corpus == NULL) {
+		err(1, "reallocarray");
+	}
+	sample = &corpus[ncorpus++];
+	sample->name = strdup(name);
+	if (sample->name == NULL) {
+		err(1, "strdup");
+	}
+	sample->n = 0;
+	sample->x = NULL;
+	sample->y = NULL;
+
+	return sample;
+}
+
+static void
+add_point(struct sample *sample, double x, double y)
+{
+	sample->x = reallocarray(sample->x, sample->n + 1, sizeof(double));
+	sample->y = reallocarray(sample->y, sample->n + 1, sizeof(double));
+	if (sample->x == NULL || sample->y == NULL) {
+		err(1, "reallocarray");
+	}
+	sample->x[sample->n] = x;
+	sample->y[sample->n] = y;
+	sample->n++;
+}
+
+// Draws the default gestures at a size of 500 units with 8 to 40 noisy
+// points per template segment, similar to a mouse at a high sampling rate
+static void
+make_corpus(void)
+{
+	for (size_t i = 0; i < NSTROKES; i++) {
+		const size_t g = i % NoGesture;
+		const int per_segment = 8 + next_random() % 32;
+		const struct default_point *p = default_gestures[g].p;
+		struct sample *sample = add_sample(default_gestures[g].name);
+		for (size_t j = 0; j + 1 < default_gestures[g].n; j++) {
+			for (int k = 0; k < per_segment; k++) {
+				const double f = (double)k / per_segment;
+				const double x = p[j].x +
+				    (p[j + 1].x - p[j].x) * f;
+				const double y = p[j].y +
+				    (p[j + 1].y - p[j].y) * f;
+				add_point(sample, x * 500 + jitter(10),
+				    y * 500 + jitter(10));
+			}
+		}
+	}
+}
+
+// A corpus file has one stroke per line: the name of the gesture it is
+// meant to be, followed by the x and y coordinates of all its points,
+// separated by white space.  Empty lines and lines starting with # are
+// skipped.
+static void
+read_corpus(const char *path)
+{
+	FILE *fp = fopen(path, "r");
+	if (fp == NULL) {
+		err(1, "fopen: %s", path);
+	}
+
+	char *line = NULL;
+	size_t linecap = 0;
+	size_t lineno = 0;
+	while (getline(&line, &linecap, fp) > 0) {
+		lineno++;
+		const char *sep = " \t\n";
+		char *name = strtok(line, sep);
+		if (name == NULL || *name == '#') {
+			continue;
+		}
+		struct sample *sample = add_sample(name);
+		char *token;
+		while ((token = strtok(NULL, sep)) != NULL) {
+			char *end;
+			const double x = strtod(token, &end);
+			token = strtok(NULL, sep);
+			if (*end != '\0' || token == NULL) {
+				errx(1, "%s:%zu: invalid point", path, lineno);
+			}
+			const double y = strtod(token, &end);
+			if (*end != '\0') {
+				errx(1, "%s:%zu: invalid point", path, lineno);
+			}
+			add_point(sample, x, y);
+		}
+	}
+	if (ferror(fp)) {
+		err(1, "getline: %s", path);
+	}
+	free(line);
+	fclose(fp);
+}
+
+static void
+write_corpus(const char *path)
+{
+	FILE *fp = fopen(path, "w");
+	if (fp == NULL) {
+		err(1, "fopen: %s", path);
+	}
+
+	fprintf(fp, "# name x y x y ...\n");
+	for (size_t i = 0; i < ncorpus; i++) {
+		fprintf(fp, "%s", corpus[i].name);
+		for (size_t j = 0; j < corpus[i].n; j++) {
+			fprintf(fp, " %.17g %.17g", corpus[i].x[j],
+			    corpus[i].y[j]);
+		}
+		fprintf(fp, "\n");
+	}
+	if (fclose(fp) == EOF) {
+		err(1, "fclose: %s", path);
+	}
+}
+
+static void
+make_stroke(const struct sample *sample, struct stroke *stroke)
+{
+	memset(stroke, 0, sizeof(*stroke));
+	for (size_t j = 0; j < sample->n; j++) {
+		stroke_add_point(stroke, sample->x[j], sample->y[j]);
+	}
+	stroke_finish(stroke);
+}
+
+// Matches like simplestroke did before templates were compared in place:
+// every template is first copied into a full struct stroke.
+static const struct gesture *
+match_by_copy(struct matcher *m, const struct stroke *stroke)
+{
+	static struct stroke candidate;
+	const struct gesture *gesture = NULL;
+	double best_score = stroke_infinity;
+	struct stroke_view view;
+
+	stroke_get_view(stroke, &view);
+	for (size_t i = 0; i < m->ngestures; i++) {
+		const struct stroke_view *t = &m->gestures[i].stroke;
+		struct stroke tmp;
+		if (t->n > MAX_STROKE_POINTS) {
+			errx(1, "%s: too many points", m->gestures[i].name);
+		}
+		memset(&tmp, 0, sizeof(tmp));
+		tmp.n = t->n;
+		tmp.is_finished = 1;
+		for (int j = 0; j < t->n; j++) {
+			tmp.t[j] = t->t[j];
+			tmp.alpha[j] = t->alpha[j];
+		}
+		candidate = tmp;
+
+		struct stroke_view cview;
+		stroke_get_view(&candidate, &cview);
+		double score = stroke_compare_ws(&m->workers[0].ws, &cview,
+		    &view, NULL, NULL);
+		if (score < best_score) {
+			best_score = score;
+			gesture = &m->gestures[i];
+		}
+	}
+
+	return gesture;
+}
+
+static size_t
+compare_bytes(const struct stroke_view *t, const struct stroke_view *v)
+{
+	static struct stroke_ws ws;
+
+	stroke_compare_ws(&ws, t, v, NULL, NULL);
+	return (t->n + v->n) * 2 * sizeof(stroke_real) + ws.used;
+}
+
+// Estimates the memory touched by one recognition: the template and
+// stroke values read, the DP tables, and the optional template copies.
+// Gestures dropped by the matcher's lower bounds are counted as well.
+// In coarse-to-fine mode every gesture is compared against the coarse
+// level and the ones the matcher refined against the full stroke.
+static size_t
+bytes_touched(struct matcher *m, const struct stroke *stroke, int copy)
+{
+	struct stroke_view view;
+	size_t bytes = 0;
+
+	stroke_get_view(stroke, &view);
+	if (!copy && m->level > 0 && m->refine > 0) {
+		struct stroke_view coarse;
+		stroke_get_level_view(stroke, m->level, &coarse);
+		matcher_match(m, stroke);
+		for (size_t i = 0; i < m->ngestures; i++) {
+			bytes += compare_bytes(&m->gestures[i].stroke, &coarse);
+		}
+		for (size_t j = 0; j < m->norder; j++) {
+			bytes += compare_bytes(&m->gestures[m->order[j]].stroke,
+			    &view);
+		}
+		return bytes;
+	}
+
+	for (size_t i = 0; i < m->ngestures; i++) {
+		bytes += compare_bytes(&m->gestures[i].stroke, &view);
+		if (copy) {
+			bytes += 2 * sizeof(struct stroke);
+		}
+	}
+
+	return bytes;
+}
+
+static void
+run(const char *name, struct matcher *m, int copy)
+{
+	struct matcher_stats stats;
+	size_t bytes = 0;
+	size_t hits = 0;
+
+	memset(&stats, 0, sizeof(stats));
+	for (size_t i = 0; i < NSTROKES; i++) {
+		bytes += ROUNDS * bytes_touched(m, &strokes[i], copy);
+	}
+
+	double start = timing_now();
+
+	for (int round = 0; round < ROUNDS; round++) {
+		for (size_t i = 0; i < NSTROKES; i++) {
+			const struct gesture *g = copy ?
+			    match_by_copy(m, &strokes[i]) :
+			    matcher_match(m, &strokes[i]);
+			if (g != NULL &&
+			    strcmp(g->name, corpus[i].name) == 0) {
+				hits++;
+			}
+			stats.ranked += m->stats.ranked;
+			stats.candidates += m->stats.candidates;
+			stats.pruned_ends += m->stats.pruned_ends;
+			stats.pruned_hist += m->stats.pruned_hist;
+			stats.compared += m->stats.compared;
+		}
+	}
+
+	const double elapsed = timing_now() - start;
+	const size_t n = ROUNDS * NSTROKES;
+	printf("%-6s %10.1f us/stroke %10zu bytes/stroke %6.1f%% correct\n",
+	    name, elapsed / n * 1e6, bytes / n, 100.0 * hits / n);
+	if (!copy) {
+		printf("%-6s %10.2f ranked, %.2f candidates, pruned %.2f by "
+		    "ends, %.2f by histogram, %.2f compared\n", "",
+		    (double)stats.ranked / n, (double)stats.candidates / n,
+		    (double)stats.pruned_ends / n,
+		    (double)stats.pruned_hist / n, (double)stats.compared / n);
+	}
+}
+
+static int
+compare_double(const void *a, const void *b)
+{
+	const double x = *(const double *)a;
+	const double y = *(const double *)b;
+
+	return (x > y) - (x < y);
+}
+
+// Runs the whole recognition of simplestroke over the corpus, from the
+// raw points to the matched gesture, and reports the latency per stroke
+static void
+run_corpus(struct matcher *m)
+{
+	static struct stroke stroke;
+	const size_t n = ROUNDS * ncorpus;
+	double *latency = reallocarray(NULL, n, sizeof(double));
+	size_t hits = 0;
+
+	if (latency == NULL) {
+		err(1, "reallocarray");
+	}
+
+	const double start = timing_now();
+	for (int round = 0; round < ROUNDS; round++) {
+		for (size_t i = 0; i < ncorpus; i++) {
+			const double t = timing_now();
+			make_stroke(&corpus[i], &stroke);
+			const struct gesture *g = matcher_match(m, &stroke);
+			latency[round * ncorpus + i] = timing_now() - t;
+			if (g != NULL &&
+			    strcmp(g->name, corpus[i].name) == 0) {
+				hits++;
+			}
+		}
+	}
+	const double elapsed = timing_now() - start;
+
+	qsort(latency, n, sizeof(double), compare_double);
+	printf("%zu strokes, %d rounds, %.1f strokes/s, %.1f%% correct\n",
+	    ncorpus, ROUNDS, n / elapsed, 100.0 * hits / n);
+	printf("latency us: p50 %.1f, p90 %.1f, p99 %.1f, max %.1f\n",
+	    latency[n / 2] * 1e6, latency[n * 9 / 10] * 1e6,
+	    latency[n * 99 / 100] * 1e6, latency[n - 1] * 1e6);
+	free(latency);
+}
+
+static void
+usage(void)
+{
+	fprintf(stderr, "usage: bench [-c count] [-f file] [-j jobs] "
+	    "[corpus]\n"
+	    "       bench -w corpus\n");
+	exit(1);
+}
+
+// Without a corpus the matcher's variants are compared on synthetic
+// strokes.  -w writes those strokes as a corpus.
+int
+main(int argc, char *argv[])
+{
+	struct library library;
+	const struct gesture *templates = gestures;
+	size_t ntemplates = ngestures;
+	size_t refine = 0;
+	int jobs = 1;
+	int ch;
+	const char *errstr;
+
+	while ((ch = getopt(argc, argv, "c:f:j:w:")) != -1) {
+		switch (ch) {
+			case 'c':
+				refine = strtonum(optarg, 1, 1024, &errstr);
+				if (errstr != NULL) {
+					errx(1, "count is %s: %s", errstr,
+					    optarg);
+				}
+				break;
+			case 'f':
+				library_open(&library, optarg);
+				templates = library.gestures;
+				ntemplates = library.ngestures;
+				break;
+			case 'j':
+				jobs = strtonum(optarg, 1, 256, &errstr);
+				if (errstr != NULL) {
+					errx(1, "jobs is %s: %s", errstr,
+					    optarg);
+				}
+				break;
+			case 'w':
+				make_corpus();
+				write_corpus(optarg);
+				return 0;
+			default:
+				usage();
+		}
+	}
+	argc -= optind;
+	argv += optind;
+	if (argc > 1) {
+		usage();
+	}
+
+	struct matcher m;
+	if (argc == 1) {
+		read_corpus(argv[0]);
+		if (ncorpus == 0) {
+			errx(1, "%s: no strokes", argv[0]);
+		}
+		matcher_init(&m, templates, ntemplates, jobs);
+		if (refine > 0) {
+			matcher_set_coarse(&m, 1, refine);
+		}
+		run_corpus(&m);
+		matcher_free(&m);
+		return 0;
+	}
+
+	make_corpus();
+	for (size_t i = 0; i < NSTROKES; i++) {
+		make_stroke(&corpus[i], &strokes[i]);
+	}
+	matcher_init(&m, templates, ntemplates, 1);
+	run("copy", &m, 1);
+	run("view", &m, 0);
+	for (int level = 1; level <= STROKE_LEVELS; level++) {
+		for (size_t k = 1; k <= 4; k *= 2) {
+			char name[32];
+			snprintf(name, sizeof(name), "c%d/%zu", level, k);
+			matcher_set_coarse(&m, level, k);
+			run(name, &m, 0);
+		}
+	}
+	matcher_set_coarse(&m, 0, 0);
+	matcher_free(&m);
+
+	long ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+	if (ncpu > 1) {
+		char name[32];
+		snprintf(name, sizeof(name), "view/%ld", ncpu);
+		matcher_init(&m, templates, ntemplates, ncpu);
+		run(name, &m, 0);
+		matcher_free(&m);
+	}
+
+	return 0;
+}
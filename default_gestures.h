@@ -0,0 +1,204 @@
+/*
+ * Copyright (c) 2016, 2019 Tobias Kortkamp <t@tobik.me>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION
+ * OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+#ifndef __DEFAULT_GESTURES_H__
+#define __DEFAULT_GESTURES_H__
+
+#include <stddef.h>
+
+// The built-in gestures.  They are turned into preprocessed templates at
+// build time by mkgestures.
+
+enum Gesture {
+	// straight line gestures
+	TopDown,
+	DownTop,
+	LeftRight,
+	RightLeft,
+
+	// Diagonal line gestures
+	TopLeftDown,
+	TopRightDown,
+	DownLeftTop,
+	DownRightTop,
+
+	// 'z' line gestures
+	LeftZ,  // a z starting from the left
+	RightZ, // a mirrored z starting from the right
+
+	SquareLeft,
+	SquareRight,
+
+	ArrowDown,
+	ArrowUp,
+	ArrowLeft,
+	ArrowRight,
+
+	NoGesture
+};
+
+struct default_point {
+	double x;
+	double y;
+};
+
+static const struct {
+	const char *name;
+	size_t n;
+	const struct default_point *p;
+} default_gestures[] = {
+	[TopDown] = { "TopDown", 3, (const struct default_point[]) {
+		{ 0.5, 0.0 },
+		{ 0.5, 0.5 },
+		{ 0.5, 1.0 },
+	} },
+	[DownTop] = { "DownTop", 3, (const struct default_point[]) {
+		{ 0.5, 1.0 },
+		{ 0.5, 0.5 },
+		{ 0.5, 0.0 },
+	} },
+	[LeftRight] = { "LeftRight", 3, (const struct default_point[]) {
+		{ 0.0, 0.5 },
+		{ 0.5, 0.5 },
+		{ 1.0, 0.5 },
+	} },
+	[RightLeft] = { "RightLeft", 3, (const struct default_point[]) {
+		{ 1.0, 0.5 },
+		{ 0.5, 0.5 },
+		{ 0.0, 0.5 },
+	} },
+
+	[TopLeftDown] = { "TopLeftDown", 3, (const struct default_point[]) {
+		{ 0.0, 0.0 },
+		{ 0.5, 0.5 },
+		{ 1.0, 1.0 },
+	} },
+	[TopRightDown] = { "TopRightDown", 3, (const struct default_point[]) {
+		{ 1.0, 0.0 },
+		{ 0.5, 0.5 },
+		{ 0.0, 1.0 },
+	} },
+	[DownLeftTop] = { "DownLeftTop", 3, (const struct default_point[]) {
+		{ 1.0, 1.0 },
+		{ 0.5, 0.5 },
+		{ 0.0, 0.0 },
+	} },
+	[DownRightTop] = { "DownRightTop", 3, (const struct default_point[]) {
+		{ 0.0, 1.0 },
+		{ 0.5, 0.5 },
+		{ 1.0, 0.0 },
+	} },
+
+	[LeftZ] = { "LeftZ", 9, (const struct default_point[]) {
+		{ 0.0, 0.0 },
+		{ 0.5, 0.0 },
+		{ 1.0, 0.0 },
+		{ 0.75, 0.25 },
+		{ 0.5, 0.5 },
+		{ 0.25, 0.75 },
+		{ 0.0, 1.0 },
+		{ 0.5, 1.0 },
+		{ 1.0, 1.0 },
+	} },
+	[RightZ] = { "RightZ", 9, (const struct default_point[]) {
+		{ 1.0, 1.0 },
+		{ 0.5, 1.0 },
+		{ 0.0, 1.0 },
+		{ 0.25, 0.75 },
+		{ 0.5, 0.5 },
+		{ 0.75, 0.25 },
+		{ 1.0, 0.0 },
+		{ 0.5, 0.0 },
+		{ 0.0, 0.0 },
+	} },
+
+	[SquareLeft] = { "SquareLeft", 9, (const struct default_point[]) {
+		{ 0.0, 0.0 },
+		{ 0.5, 0.0 },
+		{ 1.0, 0.0 },
+		{ 1.0, 0.5 },
+		{ 1.0, 1.0 },
+		{ 0.5, 1.0 },
+		{ 0.0, 1.0 },
+		{ 0.0, 0.5 },
+		{ 0.0, 0.0 },
+	} },
+	[SquareRight] = { "SquareRight", 9, (const struct default_point[]) {
+		{ 0.0, 0.0 },
+		{ 0.0, 0.5 },
+		{ 0.0, 1.0 },
+		{ 0.5, 1.0 },
+		{ 1.0, 1.0 },
+		{ 1.0, 0.5 },
+		{ 1.0, 0.0 },
+		{ 0.5, 0.0 },
+		{ 0.0, 0.0 },
+	} },
+
+	[ArrowDown] = { "ArrowDown", 11, (const struct default_point[]) { // v
+		{ 0.0, 0.0 },
+		{ 0.1, 0.2 },
+		{ 0.2, 0.4 },
+		{ 0.3, 0.6 },
+		{ 0.4, 0.8 },
+		{ 0.5, 1.0 },
+		{ 0.6, 0.8 },
+		{ 0.7, 0.6 },
+		{ 0.8, 0.4 },
+		{ 0.9, 0.2 },
+		{ 1.0, 0.0 },
+	} },
+	[ArrowUp] = { "ArrowUp", 11, (const struct default_point[]) { // ^
+		{ 0.0, 1.0 },
+		{ 0.1, 0.8 },
+		{ 0.2, 0.6 },
+		{ 0.3, 0.4 },
+		{ 0.4, 0.2 },
+		{ 0.5, 0.0 },
+		{ 0.6, 0.2 },
+		{ 0.7, 0.4 },
+		{ 0.8, 0.6 },
+		{ 0.9, 0.8 },
+		{ 1.0, 1.0 },
+	} },
+	[ArrowLeft] = { "ArrowLeft", 11, (const struct default_point[]) { // <
+		{ 1.0, 0.0 },
+		{ 0.8, 0.1 },
+		{ 0.6, 0.2 },
+		{ 0.4, 0.3 },
+		{ 0.2, 0.4 },
+		{ 0.0, 0.5 },
+		{ 0.2, 0.6 },
+		{ 0.4, 0.7 },
+		{ 0.6, 0.8 },
+		{ 0.8, 0.9 },
+		{ 1.0, 1.0 },
+	} },
+	[ArrowRight] = { "ArrowRight", 11, (const struct default_point[]) { // >
+		{ 0.0, 0.0 },
+		{ 0.2, 0.1 },
+		{ 0.4, 0.2 },
+		{ 0.6, 0.3 },
+		{ 0.8, 0.4 },
+		{ 1.0, 0.5 },
+		{ 0.8, 0.6 },
+		{ 0.6, 0.7 },
+		{ 0.4, 0.8 },
+		{ 0.2, 0.9 },
+		{ 0.0, 1.0 },
+	} },
+};
+
+#endif
@@ -0,0 +1,435 @@
+/* Generated by mkgestures, regenerate with make update-gestures. */
+
+#include "config.h"
+
+#include "gestures.h"
+
+static const stroke_real gesture_t[] = {
+	// TopDown
+	0x0p+0,
+	0x1p-1,
+	0x1p+0,
+	// DownTop
+	0x0p+0,
+	0x1p-1,
+	0x1p+0,
+	// LeftRight
+	0x0p+0,
+	0x1p-1,
+	0x1p+0,
+	// RightLeft
+	0x0p+0,
+	0x1p-1,
+	0x1p+0,
+	// TopLeftDown
+	0x0p+0,
+	0x1p-1,
+	0x1p+0,
+	// TopRightDown
+	0x0p+0,
+	0x1p-1,
+	0x1p+0,
+	// DownLeftTop
+	0x0p+0,
+	0x1p-1,
+	0x1p+0,
+	// DownRightTop
+	0x0p+0,
+	0x1p-1,
+	0x1p+0,
+	// LeftZ
+	0x0p+0,
+	0x1.2bec333018866p-3,
+	0x1.2bec333018866p-2,
+	0x1.95f619980c433p-2,
+	0x1.fffffffffffffp-2,
+	0x1.3504f333f9de6p-1,
+	0x1.6a09e667f3bcdp-1,
+	0x1.b504f333f9de6p-1,
+	0x1p+0,
+	// RightZ
+	0x0p+0,
+	0x1.2bec333018866p-3,
+	0x1.2bec333018866p-2,
+	0x1.95f619980c433p-2,
+	0x1.fffffffffffffp-2,
+	0x1.3504f333f9de6p-1,
+	0x1.6a09e667f3bcdp-1,
+	0x1.b504f333f9de6p-1,
+	0x1p+0,
+	// SquareLeft
+	0x0p+0,
+	0x1p-3,
+	0x1p-2,
+	0x1.8p-2,
+	0x1p-1,
+	0x1.4p-1,
+	0x1.8p-1,
+	0x1.cp-1,
+	0x1p+0,
+	// SquareRight
+	0x0p+0,
+	0x1p-3,
+	0x1p-2,
+	0x1.8p-2,
+	0x1p-1,
+	0x1.4p-1,
+	0x1.8p-1,
+	0x1.cp-1,
+	0x1p+0,
+	// ArrowDown
+	0x0p+0,
+	0x1.999999999999ap-4,
+	0x1.999999999999ap-3,
+	0x1.3333333333333p-2,
+	0x1.999999999999ap-2,
+	0x1p-1,
+	0x1.3333333333333p-1,
+	0x1.6666666666666p-1,
+	0x1.9999999999999p-1,
+	0x1.cccccccccccccp-1,
+	0x1p+0,
+	// ArrowUp
+	0x0p+0,
+	0x1.999999999999ap-4,
+	0x1.999999999999bp-3,
+	0x1.3333333333334p-2,
+	0x1.999999999999bp-2,
+	0x1.0000000000001p-1,
+	0x1.3333333333334p-1,
+	0x1.6666666666667p-1,
+	0x1.999999999999ap-1,
+	0x1.ccccccccccccep-1,
+	0x1p+0,
+	// ArrowLeft
+	0x0p+0,
+	0x1.999999999999ap-4,
+	0x1.999999999999bp-3,
+	0x1.3333333333334p-2,
+	0x1.999999999999bp-2,
+	0x1.0000000000001p-1,
+	0x1.3333333333334p-1,
+	0x1.6666666666667p-1,
+	0x1.999999999999ap-1,
+	0x1.ccccccccccccep-1,
+	0x1p+0,
+	// ArrowRight
+	0x0p+0,
+	0x1.999999999999ap-4,
+	0x1.999999999999ap-3,
+	0x1.3333333333333p-2,
+	0x1.999999999999ap-2,
+	0x1p-1,
+	0x1.3333333333333p-1,
+	0x1.6666666666666p-1,
+	0x1.9999999999999p-1,
+	0x1.cccccccccccccp-1,
+	0x1p+0,
+};
+
+static const stroke_real gesture_alpha[] = {
+	// TopDown
+	0x1p-1,
+	0x1p-1,
+	0x0p+0,
+	// DownTop
+	-0x1p-1,
+	-0x1p-1,
+	0x0p+0,
+	// LeftRight
+	0x0p+0,
+	0x0p+0,
+	0x0p+0,
+	// RightLeft
+	0x1p+0,
+	0x1p+0,
+	0x0p+0,
+	// TopLeftDown
+	0x1p-2,
+	0x1p-2,
+	0x0p+0,
+	// TopRightDown
+	0x1.8p-1,
+	0x1.8p-1,
+	0x0p+0,
+	// DownLeftTop
+	-0x1.8p-1,
+	-0x1.8p-1,
+	0x0p+0,
+	// DownRightTop
+	-0x1p-2,
+	-0x1p-2,
+	0x0p+0,
+	// LeftZ
+	0x0p+0,
+	0x0p+0,
+	0x1.8p-1,
+	0x1.8p-1,
+	0x1.8p-1,
+	0x1.8p-1,
+	0x0p+0,
+	0x0p+0,
+	0x0p+0,
+	// RightZ
+	0x1p+0,
+	0x1p+0,
+	-0x1p-2,
+	-0x1p-2,
+	-0x1p-2,
+	-0x1p-2,
+	0x1p+0,
+	0x1p+0,
+	0x0p+0,
+	// SquareLeft
+	0x0p+0,
+	0x0p+0,
+	0x1p-1,
+	0x1p-1,
+	0x1p+0,
+	0x1p+0,
+	-0x1p-1,
+	-0x1p-1,
+	0x0p+0,
+	// SquareRight
+	0x1p-1,
+	0x1p-1,
+	0x0p+0,
+	0x0p+0,
+	-0x1p-1,
+	-0x1p-1,
+	0x1p+0,
+	0x1p+0,
+	0x0p+0,
+	// ArrowDown
+	0x1.68dfd7131067dp-2,
+	0x1.68dfd7131067cp-2,
+	0x1.68dfd7131067cp-2,
+	0x1.68dfd7131067cp-2,
+	0x1.68dfd7131067cp-2,
+	-0x1.68dfd7131067cp-2,
+	-0x1.68dfd7131067dp-2,
+	-0x1.68dfd71310679p-2,
+	-0x1.68dfd7131067dp-2,
+	-0x1.68dfd7131067dp-2,
+	0x0p+0,
+	// ArrowUp
+	-0x1.68dfd7131067cp-2,
+	-0x1.68dfd7131067cp-2,
+	-0x1.68dfd7131067cp-2,
+	-0x1.68dfd7131067cp-2,
+	-0x1.68dfd7131067dp-2,
+	0x1.68dfd7131067dp-2,
+	0x1.68dfd7131067dp-2,
+	0x1.68dfd71310679p-2,
+	0x1.68dfd7131067dp-2,
+	0x1.68dfd7131067cp-2,
+	0x0p+0,
+	// ArrowLeft
+	0x1.b46feb898833ep-1,
+	0x1.b46feb898833ep-1,
+	0x1.b46feb898833ep-1,
+	0x1.b46feb898833ep-1,
+	0x1.b46feb898833fp-1,
+	0x1.2e4051d9df307p-3,
+	0x1.2e4051d9df307p-3,
+	0x1.2e4051d9df30dp-3,
+	0x1.2e4051d9df306p-3,
+	0x1.2e4051d9df308p-3,
+	0x0p+0,
+	// ArrowRight
+	0x1.2e4051d9df307p-3,
+	0x1.2e4051d9df30ap-3,
+	0x1.2e4051d9df308p-3,
+	0x1.2e4051d9df308p-3,
+	0x1.2e4051d9df308p-3,
+	0x1.b46feb898833ep-1,
+	0x1.b46feb898833fp-1,
+	0x1.b46feb898833cp-1,
+	0x1.b46feb898833fp-1,
+	0x1.b46feb898833fp-1,
+	0x0p+0,
+};
+
+static const struct stroke_features gesture_features[] = {
+	// TopDown
+	{ {
+		0x0p+0, 0x0p+0, 0x0p+0, 0x0p+0,
+		0x0p+0, 0x0p+0, 0x0p+0, 0x0p+0,
+		0x0p+0, 0x0p+0, 0x0p+0, 0x0p+0,
+		0x1p+0, 0x0p+0, 0x0p+0, 0x0p+0
+	},
+		0x1p-1, 0x1p-1,
+		0x1p-1, 0x1p-1 },
+	// DownTop
+	{ {
+		0x0p+0, 0x0p+0, 0x0p+0, 0x0p+0,
+		0x1p+0, 0x0p+0, 0x0p+0, 0x0p+0,
+		0x0p+0, 0x0p+0, 0x0p+0, 0x0p+0,
+		0x0p+0, 0x0p+0, 0x0p+0, 0x0p+0
+	},
+		-0x1p-1, 0x1p-1,
+		-0x1p-1, 0x1p-1 },
+	// LeftRight
+	{ {
+		0x0p+0, 0x0p+0, 0x0p+0, 0x0p+0,
+		0x0p+0, 0x0p+0, 0x0p+0, 0x0p+0,
+		0x1p+0, 0x0p+0, 0x0p+0, 0x0p+0,
+		0x0p+0, 0x0p+0, 0x0p+0, 0x0p+0
+	},
+		0x0p+0, 0x1p-1,
+		0x0p+0, 0x1p-1 },
+	// RightLeft
+	{ {
+		0x0p+0, 0x0p+0, 0x0p+0, 0x0p+0,
+		0x0p+0, 0x0p+0, 0x0p+0, 0x0p+0,
+		0x0p+0, 0x0p+0, 0x0p+0, 0x0p+0,
+		0x0p+0, 0x0p+0, 0x0p+0, 0x1p+0
+	},
+		0x1p+0, 0x1p-1,
+		0x1p+0, 0x1p-1 },
+	// TopLeftDown
+	{ {
+		0x0p+0, 0x0p+0, 0x0p+0, 0x0p+0,
+		0x0p+0, 0x0p+0, 0x0p+0, 0x0p+0,
+		0x0p+0, 0x0p+0, 0x1p+0, 0x0p+0,
+		0x0p+0, 0x0p+0, 0x0p+0, 0x0p+0
+	},
+		0x1p-2, 0x1p-1,
+		0x1p-2, 0x1p-1 },
+	// TopRightDown
+	{ {
+		0x0p+0, 0x0p+0, 0x0p+0, 0x0p+0,
+		0x0p+0, 0x0p+0, 0x0p+0, 0x0p+0,
+		0x0p+0, 0x0p+0, 0x0p+0, 0x0p+0,
+		0x0p+0, 0x0p+0, 0x1p+0, 0x0p+0
+	},
+		0x1.8p-1, 0x1p-1,
+		0x1.8p-1, 0x1p-1 },
+	// DownLeftTop
+	{ {
+		0x0p+0, 0x0p+0, 0x1p+0, 0x0p+0,
+		0x0p+0, 0x0p+0, 0x0p+0, 0x0p+0,
+		0x0p+0, 0x0p+0, 0x0p+0, 0x0p+0,
+		0x0p+0, 0x0p+0, 0x0p+0, 0x0p+0
+	},
+		-0x1.8p-1, 0x1p-1,
+		-0x1.8p-1, 0x1p-1 },
+	// DownRightTop
+	{ {
+		0x0p+0, 0x0p+0, 0x0p+0, 0x0p+0,
+		0x0p+0, 0x0p+0, 0x1p+0, 0x0p+0,
+		0x0p+0, 0x0p+0, 0x0p+0, 0x0p+0,
+		0x0p+0, 0x0p+0, 0x0p+0, 0x0p+0
+	},
+		-0x1p-2, 0x1p-1,
+		-0x1p-2, 0x1p-1 },
+	// LeftZ
+	{ {
+		0x0p+0, 0x0p+0, 0x0p+0, 0x0p+0,
+		0x0p+0, 0x0p+0, 0x0p+0, 0x0p+0,
+		0x1.2bec333018866p-1, 0x0p+0, 0x0p+0, 0x0p+0,
+		0x0p+0, 0x0p+0, 0x1.a827999fcef34p-2, 0x0p+0
+	},
+		0x0p+0, 0x1.2bec333018866p-3,
+		0x0p+0, 0x1.2bec333018868p-3 },
+	// RightZ
+	{ {
+		0x0p+0, 0x0p+0, 0x0p+0, 0x0p+0,
+		0x0p+0, 0x0p+0, 0x1.a827999fcef34p-2, 0x0p+0,
+		0x0p+0, 0x0p+0, 0x0p+0, 0x0p+0,
+		0x0p+0, 0x0p+0, 0x0p+0, 0x1.2bec333018866p-1
+	},
+		0x1p+0, 0x1.2bec333018866p-3,
+		0x1p+0, 0x1.2bec333018868p-3 },
+	// SquareLeft
+	{ {
+		0x0p+0, 0x0p+0, 0x0p+0, 0x0p+0,
+		0x1p-2, 0x0p+0, 0x0p+0, 0x0p+0,
+		0x1p-2, 0x0p+0, 0x0p+0, 0x0p+0,
+		0x1p-2, 0x0p+0, 0x0p+0, 0x1p-2
+	},
+		0x0p+0, 0x1p-3,
+		-0x1p-1, 0x1p-3 },
+	// SquareRight
+	{ {
+		0x0p+0, 0x0p+0, 0x0p+0, 0x0p+0,
+		0x1p-2, 0x0p+0, 0x0p+0, 0x0p+0,
+		0x1p-2, 0x0p+0, 0x0p+0, 0x0p+0,
+		0x1p-2, 0x0p+0, 0x0p+0, 0x1p-2
+	},
+		0x1p-1, 0x1p-3,
+		0x1p+0, 0x1p-3 },
+	// ArrowDown
+	{ {
+		0x0p+0, 0x0p+0, 0x0p+0, 0x0p+0,
+		0x0p+0, 0x1p-1, 0x0p+0, 0x0p+0,
+		0x0p+0, 0x0p+0, 0x1p-1, 0x0p+0,
+		0x0p+0, 0x0p+0, 0x0p+0, 0x0p+0
+	},
+		0x1.68dfd7131067dp-2, 0x1.999999999999ap-4,
+		-0x1.68dfd7131067dp-2, 0x1.99999999999ap-4 },
+	// ArrowUp
+	{ {
+		0x0p+0, 0x0p+0, 0x0p+0, 0x0p+0,
+		0x0p+0, 0x1.0000000000001p-1, 0x0p+0, 0x0p+0,
+		0x0p+0, 0x0p+0, 0x1.ffffffffffffep-2, 0x0p+0,
+		0x0p+0, 0x0p+0, 0x0p+0, 0x0p+0
+	},
+		-0x1.68dfd7131067cp-2, 0x1.999999999999ap-4,
+		0x1.68dfd7131067cp-2, 0x1.999999999999p-4 },
+	// ArrowLeft
+	{ {
+		0x0p+0, 0x0p+0, 0x0p+0, 0x0p+0,
+		0x0p+0, 0x0p+0, 0x0p+0, 0x0p+0,
+		0x0p+0, 0x1.ffffffffffffep-2, 0x0p+0, 0x0p+0,
+		0x0p+0, 0x0p+0, 0x1.0000000000001p-1, 0x0p+0
+	},
+		0x1.b46feb898833ep-1, 0x1.999999999999ap-4,
+		0x1.2e4051d9df308p-3, 0x1.999999999999p-4 },
+	// ArrowRight
+	{ {
+		0x0p+0, 0x0p+0, 0x0p+0, 0x0p+0,
+		0x0p+0, 0x0p+0, 0x0p+0, 0x0p+0,
+		0x0p+0, 0x1p-1, 0x0p+0, 0x0p+0,
+		0x0p+0, 0x0p+0, 0x1p-1, 0x0p+0
+	},
+		0x1.2e4051d9df307p-3, 0x1.999999999999ap-4,
+		0x1.b46feb898833fp-1, 0x1.99999999999ap-4 },
+};
+
+const struct gesture gestures[] = {
+	{ "TopDown", { 3, &gesture_t[0], &gesture_alpha[0],
+	    &gesture_features[0] } },
+	{ "DownTop", { 3, &gesture_t[3], &gesture_alpha[3],
+	    &gesture_features[1] } },
+	{ "LeftRight", { 3, &gesture_t[6], &gesture_alpha[6],
+	    &gesture_features[2] } },
+	{ "RightLeft", { 3, &gesture_t[9], &gesture_alpha[9],
+	    &gesture_features[3] } },
+	{ "TopLeftDown", { 3, &gesture_t[12], &gesture_alpha[12],
+	    &gesture_features[4] } },
+	{ "TopRightDown", { 3, &gesture_t[15], &gesture_alpha[15],
+	    &gesture_features[5] } },
+	{ "DownLeftTop", { 3, &gesture_t[18], &gesture_alpha[18],
+	    &gesture_features[6] } },
+	{ "DownRightTop", { 3, &gesture_t[21], &gesture_alpha[21],
+	    &gesture_features[7] } },
+	{ "LeftZ", { 9, &gesture_t[24], &gesture_alpha[24],
+	    &gesture_features[8] } },
+	{ "RightZ", { 9, &gesture_t[33], &gesture_alpha[33],
+	    &gesture_features[9] } },
+	{ "SquareLeft", { 9, &gesture_t[42], &gesture_alpha[42],
+	    &gesture_features[10] } },
+	{ "SquareRight", { 9, &gesture_t[51], &gesture_alpha[51],
+	    &gesture_features[11] } },
+	{ "ArrowDown", { 11, &gesture_t[60], &gesture_alpha[60],
+	    &gesture_features[12] } },
+	{ "ArrowUp", { 11, &gesture_t[71], &gesture_alpha[71],
+	    &gesture_features[13] } },
+	{ "ArrowLeft", { 11, &gesture_t[82], &gesture_alpha[82],
+	    &gesture_features[14] } },
+	{ "ArrowRight", { 11, &gesture_t[93], &gesture_alpha[93],
+	    &gesture_features[15] } },
+};
+
+const size_t ngestures = 16;
@@ -0,0 +1,32 @@
+/*
+ * Copyright (c) 2020 Tobias Kortkamp <t@tobik.me>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION
+ * OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+#ifndef __GESTURES_H__
+#define __GESTURES_H__
+
+#include "stroke.h"
+
+// A gesture's stroke points into flat pools of t and alpha values.  Only
+// those are needed to compare strokes.
+struct gesture {
+	const char *name;
+	struct stroke_view stroke;
+};
+
+// Preprocessed built-in gestures generated by mkgestures
+extern const struct gesture gestures[];
+extern const size_t ngestures;
+
+#endif
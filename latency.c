@@ -0,0 +1,319 @@
+/*
+ * Copyright (c) 2020 Tobias Kortkamp <t@tobik.me>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION
+ * OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+// Measures simplestroke's latency end to end.  A virtual pointer is
+// created through uinput, simplestroke -d is started on it and the
+// built-in gestures are drawn with it at a given event rate.  The time
+// from the button release to the gesture's name on simplestroke's stdout
+// is the latency.  Needs write access to /dev/uinput and read access to
+// the /dev/input/event* devices.
+
+#include "config.h"
+
+#include <sys/ioctl.h>
+#include <sys/param.h>
+#include <sys/wait.h>
+#if HAVE_ERR
+# include <err.h>
+#endif
+#include <fcntl.h>
+#include <math.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#if defined(__DragonFly__)
+#include <dev/misc/evdev/input.h>
+#include <dev/misc/evdev/uinput.h>
+#elif defined(__FreeBSD__)
+#include <dev/evdev/input.h>
+#include <dev/evdev/uinput.h>
+#else
+#include <linux/input.h>
+#include <linux/uinput.h>
+#endif
+
+#include "default_gestures.h"
+#include "timing.h"
+
+// Gestures are drawn 400 units wide in 300 ms, whatever the rate
+#define GESTURE_SIZE		400
+#define GESTURE_DURATION	0.3
+
+static char default_simplestroke[] = "./simplestroke";
+static char daemon_flag[] = "-d";
+static int uinput = -1;
+
+static void
+emit(int type, int code, int value)
+{
+	struct input_event ev;
+
+	memset(&ev, 0, sizeof(ev));
+	ev.type = type;
+	ev.code = code;
+	ev.value = value;
+	if (write(uinput, &ev, sizeof(ev)) != sizeof(ev)) {
+		err(1, "write: /dev/uinput");
+	}
+}
+
+static void
+create_pointer(void)
+{
+	struct uinput_setup setup;
+
+	uinput = open("/dev/uinput", O_WRONLY | O_NONBLOCK);
+	if (uinput == -1) {
+		err(1, "open: /dev/uinput");
+	}
+	if (ioctl(uinput, UI_SET_EVBIT, EV_KEY) == -1 ||
+	    ioctl(uinput, UI_SET_KEYBIT, BTN_LEFT) == -1 ||
+	    ioctl(uinput, UI_SET_EVBIT, EV_REL) == -1 ||
+	    ioctl(uinput, UI_SET_RELBIT, REL_X) == -1 ||
+	    ioctl(uinput, UI_SET_RELBIT, REL_Y) == -1 ||
+	    ioctl(uinput, UI_SET_PROPBIT, INPUT_PROP_POINTER) == -1) {
+		err(1, "ioctl: /dev/uinput");
+	}
+
+	memset(&setup, 0, sizeof(setup));
+	setup.id.bustype = BUS_VIRTUAL;
+	setup.id.vendor = 0x1234;
+	setup.id.product = 0x5678;
+	snprintf(setup.name, sizeof(setup.name), "simplestroke latency");
+	if (ioctl(uinput, UI_DEV_SETUP, &setup) == -1 ||
+	    ioctl(uinput, UI_DEV_CREATE) == -1) {
+		err(1, "ioctl: /dev/uinput");
+	}
+
+	// Give the system time to create the event device node
+	sleep(1);
+}
+
+static pid_t
+spawn(char *argv[], FILE **in, FILE **out)
+{
+	int to_child[2];
+	int from_child[2];
+
+	if (pipe(to_child) == -1 || pipe(from_child) == -1) {
+		err(1, "pipe");
+	}
+
+	pid_t pid = fork();
+	if (pid == -1) {
+		err(1, "fork");
+	} else if (pid == 0) {
+		if (dup2(to_child[0], STDIN_FILENO) == -1 ||
+		    dup2(from_child[1], STDOUT_FILENO) == -1) {
+			err(1, "dup2");
+		}
+		close(to_child[0]);
+		close(to_child[1]);
+		close(from_child[0]);
+		close(from_child[1]);
+		execvp(argv[0], argv);
+		err(1, "execvp: %s", argv[0]);
+	}
+
+	close(to_child[0]);
+	close(from_child[1]);
+	if ((*in = fdopen(to_child[1], "w")) == NULL ||
+	    (*out = fdopen(from_child[0], "r")) == NULL) {
+		err(1, "fdopen");
+	}
+
+	return pid;
+}
+
+// Moves the pointer along the gesture with rate events per second.  The
+// positions are rounded, the rounding error is carried over to the next
+// event so that the whole gesture has the right size.
+static void
+draw(const struct default_point *p, size_t n, int rate)
+{
+	const int events = MAX(1, GESTURE_DURATION * rate);
+	const double interval = 1.0 / rate;
+	double length = 0.0;
+
+	for (size_t i = 0; i + 1 < n; i++) {
+		length += hypot(p[i + 1].x - p[i].x, p[i + 1].y - p[i].y);
+	}
+
+	int x = lround(p[0].x * GESTURE_SIZE);
+	int y = lround(p[0].y * GESTURE_SIZE);
+	size_t segment = 0;
+	double segment_start = 0.0;
+	double start = timing_now();
+	for (int k = 1; k <= events; k++) {
+		// Find the point k / events of the way along the gesture
+		const double at = length * k / events;
+		double seg_len;
+		while (segment + 2 < n &&
+		    segment_start + (seg_len = hypot(p[segment + 1].x -
+		    p[segment].x, p[segment + 1].y - p[segment].y)) < at) {
+			segment_start += seg_len;
+			segment++;
+		}
+		seg_len = hypot(p[segment + 1].x - p[segment].x,
+		    p[segment + 1].y - p[segment].y);
+		const double f = seg_len > 0 ?
+		    MIN(1.0, (at - segment_start) / seg_len) : 1.0;
+		const int nx = lround((p[segment].x +
+		    (p[segment + 1].x - p[segment].x) * f) * GESTURE_SIZE);
+		const int ny = lround((p[segment].y +
+		    (p[segment + 1].y - p[segment].y) * f) * GESTURE_SIZE);
+
+		timing_sleep_until(start + k * interval);
+		if (nx != x) {
+			emit(EV_REL, REL_X, nx - x);
+		}
+		if (ny != y) {
+			emit(EV_REL, REL_Y, ny - y);
+		}
+		emit(EV_SYN, SYN_REPORT, 0);
+		x = nx;
+		y = ny;
+	}
+}
+
+static int
+compare_double(const void *a, const void *b)
+{
+	const double x = *(const double *)a;
+	const double y = *(const double *)b;
+
+	return (x > y) - (x < y);
+}
+
+static void
+usage(void)
+{
+	fprintf(stderr, "usage: latency [-n rounds] [-r rate] "
+	    "[simplestroke [arg ...]]\n");
+	exit(1);
+}
+
+int
+main(int argc, char *argv[])
+{
+	int rounds = 5;
+	int rate = 1000;
+	int ch;
+	const char *errstr;
+
+	while ((ch = getopt(argc, argv, "n:r:")) != -1) {
+		switch (ch) {
+			case 'n':
+				rounds = strtonum(optarg, 1, 1000, &errstr);
+				if (errstr != NULL) {
+					errx(1, "rounds is %s: %s", errstr,
+					    optarg);
+				}
+				break;
+			case 'r':
+				rate = strtonum(optarg, 125, 8000, &errstr);
+				if (errstr != NULL) {
+					errx(1, "rate is %s: %s", errstr,
+					    optarg);
+				}
+				break;
+			default:
+				usage();
+		}
+	}
+	argc -= optind;
+	argv += optind;
+
+	// simplestroke -d [arg ...]
+	char **child = calloc(argc + 3, sizeof(char *));
+	if (child == NULL) {
+		err(1, "calloc");
+	}
+	child[0] = argc > 0 ? argv[0] : default_simplestroke;
+	child[1] = daemon_flag;
+	for (int i = 1; i < argc; i++) {
+		child[i + 1] = argv[i];
+	}
+
+	signal(SIGPIPE, SIG_IGN);
+	create_pointer();
+
+	FILE *in, *out;
+	const pid_t pid = spawn(child, &in, &out);
+	// Let simplestroke find the devices
+	sleep(1);
+
+	const size_t n = (size_t)rounds * NoGesture;
+	double *latency = calloc(n, sizeof(double));
+	if (latency == NULL) {
+		err(1, "calloc");
+	}
+	char *line = NULL;
+	size_t linecap = 0;
+	size_t hits = 0;
+	for (size_t i = 0; i < n; i++) {
+		const size_t g = i % NoGesture;
+
+		// Like a window manager would: press the button, then start
+		// the recognition, which drops the press again
+		emit(EV_KEY, BTN_LEFT, 1);
+		emit(EV_SYN, SYN_REPORT, 0);
+		if (fprintf(in, "\n") < 0 || fflush(in) == EOF) {
+			err(1, "simplestroke exited");
+		}
+		timing_sleep_until(timing_now() + 0.05);
+
+		draw(default_gestures[g].p, default_gestures[g].n, rate);
+		emit(EV_KEY, BTN_LEFT, 0);
+		emit(EV_SYN, SYN_REPORT, 0);
+		const double released = timing_now();
+
+		ssize_t len = getline(&line, &linecap, out);
+		if (len <= 0) {
+			errx(1, "simplestroke exited");
+		}
+		latency[i] = timing_now() - released;
+		line[strcspn(line, "\n")] = '\0';
+		if (strcmp(line, default_gestures[g].name) == 0) {
+			hits++;
+		}
+		printf("%-12s %-12s %8.1f us\n", default_gestures[g].name,
+		    *line ? line : "-", latency[i] * 1e6);
+		timing_sleep_until(timing_now() + 0.05);
+	}
+
+	fclose(in);
+	fclose(out);
+	waitpid(pid, NULL, 0);
+	ioctl(uinput, UI_DEV_DESTROY);
+	close(uinput);
+
+	qsort(latency, n, sizeof(double), compare_double);
+	printf("%d Hz, %zu gestures, %.1f%% correct\n", rate, n,
+	    100.0 * hits / n);
+	printf("latency us: p50 %.1f, p90 %.1f, p99 %.1f, max %.1f\n",
+	    latency[n / 2] * 1e6, latency[n * 9 / 10] * 1e6,
+	    latency[n * 99 / 100] * 1e6, latency[n - 1] * 1e6);
+
+	free(line);
+	free(latency);
+	free(child);
+
+	return 0;
+}
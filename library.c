@@ -0,0 +1,418 @@
+/*
+ * Copyright (c) 2020 Tobias Kortkamp <t@tobik.me>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION
+ * OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include "config.h"
+
+#include <sys/mman.h>
+#include <sys/param.h>
+#include <sys/stat.h>
+#include <assert.h>
+#if HAVE_ERR
+# include <err.h>
+#endif
+#include <fcntl.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "gestures.h"
+#include "library.h"
+#include "stroke.h"
+
+// Whether count elements of the given size fit into the file at offset
+static int
+library_section(const struct library_header *h, uint64_t offset,
+    uint64_t count, size_t size)
+{
+	return offset % 8 == 0 && offset <= h->size &&
+	    count <= (h->size - offset) / size;
+}
+
+static uint32_t
+library_swap32(uint32_t x)
+{
+	return x >> 24 | (x >> 8 & 0xff00) | (x << 8 & 0xff0000) | x << 24;
+}
+
+static void
+library_check(const struct library_header *h, size_t size, const char *path)
+{
+	if (size < sizeof(*h) ||
+	    memcmp(h->magic, LIBRARY_MAGIC, sizeof(h->magic)) != 0) {
+		errx(1, "%s: not a gesture library", path);
+	}
+	if (h->version == library_swap32(LIBRARY_VERSION)) {
+		errx(1, "%s: written with the other byte order", path);
+	}
+	if (h->version != LIBRARY_VERSION) {
+		errx(1, "%s: unsupported version %u", path, h->version);
+	}
+	if (h->real_size != sizeof(stroke_real)) {
+		errx(1, "%s: built for %u byte reals, expected %zu", path,
+		    h->real_size, sizeof(stroke_real));
+	}
+	if (h->size != size ||
+	    !library_section(h, h->entries, h->ngestures,
+	    sizeof(struct library_entry)) ||
+	    !library_section(h, h->features, h->ngestures,
+	    sizeof(struct stroke_features)) ||
+	    !library_section(h, h->t, h->npoints, sizeof(stroke_real)) ||
+	    !library_section(h, h->alpha, h->npoints, sizeof(stroke_real)) ||
+	    !library_section(h, h->names, 1, 1)) {
+		errx(1, "%s: truncated or corrupt", path);
+	}
+}
+
+// Maps the library at path and sets up its gestures.  The template data
+// is used in place, only the offsets and the entries are checked.
+void
+library_open(struct library *lib, const char *path)
+{
+	struct stat st;
+
+	int fd = open(path, O_RDONLY);
+	if (fd == -1) {
+		err(1, "open: %s", path);
+	}
+	if (fstat(fd, &st) == -1) {
+		err(1, "fstat: %s", path);
+	}
+	lib->size = st.st_size;
+	if (lib->size < sizeof(struct library_header)) {
+		errx(1, "%s: not a gesture library", path);
+	}
+	lib->map = mmap(NULL, lib->size, PROT_READ, MAP_SHARED, fd, 0);
+	if (lib->map == MAP_FAILED) {
+		err(1, "mmap: %s", path);
+	}
+	close(fd);
+
+	const char *base = lib->map;
+	const struct library_header *h = lib->map;
+	library_check(h, lib->size, path);
+
+	const struct library_entry *entries =
+	    (const struct library_entry *)(base + h->entries);
+	const struct stroke_features *features =
+	    (const struct stroke_features *)(base + h->features);
+	const stroke_real *t = (const stroke_real *)(base + h->t);
+	const stroke_real *alpha = (const stroke_real *)(base + h->alpha);
+	const char *names = base + h->names;
+	const size_t names_size = h->size - h->names;
+	if (names[names_size - 1] != '\0') {
+		errx(1, "%s: truncated or corrupt", path);
+	}
+
+	lib->ngestures = h->ngestures;
+	lib->gestures = reallocarray(NULL, MAX(1, lib->ngestures),
+	    sizeof(struct gesture));
+	if (lib->gestures == NULL) {
+		err(1, "reallocarray");
+	}
+	for (size_t i = 0; i < lib->ngestures; i++) {
+		const struct library_entry *e = &entries[i];
+		// Strokes never have more than MAX_STROKE_POINTS points,
+		// and copying one must not overflow a struct stroke
+		if (e->name >= names_size || e->n < 2 ||
+		    e->n > MAX_STROKE_POINTS || e->offset > h->npoints ||
+		    e->n > h->npoints - e->offset) {
+			errx(1, "%s: corrupt gesture %zu", path, i);
+		}
+		struct gesture *g = &lib->gestures[i];
+		g->name = names + e->name;
+		g->stroke.n = e->n;
+		g->stroke.t = t + e->offset;
+		g->stroke.alpha = alpha + e->offset;
+		g->stroke.features = &features[i];
+	}
+}
+
+void
+library_close(struct library *lib)
+{
+	free(lib->gestures);
+	if (munmap(lib->map, lib->size) == -1) {
+		err(1, "munmap");
+	}
+	lib->gestures = NULL;
+	lib->ngestures = 0;
+	lib->map = NULL;
+	lib->size = 0;
+}
+
+// Replaces file in the directory dirfd with a library of the
+// given gestures.  All of them must have features.  The library is
+// written to a temporary file that is then renamed over the old one, so
+// processes that have the old library mapped keep reading it unchanged.
+// Only the *at() functions are used, so this also works in a sandbox
+// that dirfd was kept open for.
+void
+library_write(int dirfd, const char *file, const struct gesture *gestures,
+    size_t ngestures)
+{
+	struct library_header h;
+	size_t npoints = 0;
+	size_t names_size = 0;
+
+	for (size_t i = 0; i < ngestures; i++) {
+		assert(gestures[i].stroke.features != NULL);
+		npoints += gestures[i].stroke.n;
+		names_size += strlen(gestures[i].name) + 1;
+	}
+	if (ngestures > UINT32_MAX || npoints > UINT32_MAX ||
+	    names_size > UINT32_MAX) {
+		errx(1, "%s: too many gestures", file);
+	}
+
+	memset(&h, 0, sizeof(h));
+	memcpy(h.magic, LIBRARY_MAGIC, sizeof(h.magic));
+	h.version = LIBRARY_VERSION;
+	h.real_size = sizeof(stroke_real);
+	h.ngestures = ngestures;
+	h.npoints = npoints;
+	h.entries = roundup(sizeof(h), 8);
+	h.features = roundup(h.entries +
+	    ngestures * sizeof(struct library_entry), 8);
+	h.t = roundup(h.features + ngestures * sizeof(struct stroke_features),
+	    8);
+	h.alpha = roundup(h.t + npoints * sizeof(stroke_real), 8);
+	h.names = roundup(h.alpha + npoints * sizeof(stroke_real), 8);
+	h.size = h.names + MAX(1, names_size);
+
+	char *buf = calloc(1, h.size);
+	if (buf == NULL) {
+		err(1, "calloc");
+	}
+	memcpy(buf, &h, sizeof(h));
+	struct library_entry *entries =
+	    (struct library_entry *)(buf + h.entries);
+	struct stroke_features *features =
+	    (struct stroke_features *)(buf + h.features);
+	stroke_real *t = (stroke_real *)(buf + h.t);
+	stroke_real *alpha = (stroke_real *)(buf + h.alpha);
+	char *names = buf + h.names;
+	size_t offset = 0;
+	size_t name = 0;
+	for (size_t i = 0; i < ngestures; i++) {
+		const struct gesture *g = &gestures[i];
+		const size_t len = strlen(g->name) + 1;
+		entries[i].name = name;
+		entries[i].n = g->stroke.n;
+		entries[i].offset = offset;
+		features[i] = *g->stroke.features;
+		memcpy(&t[offset], g->stroke.t, g->stroke.n * sizeof(*t));
+		memcpy(&alpha[offset], g->stroke.alpha,
+		    g->stroke.n * sizeof(*alpha));
+		memcpy(&names[name], g->name, len);
+		offset += g->stroke.n;
+		name += len;
+	}
+
+	char *tmp;
+	if (asprintf(&tmp, ".%s.%ld", file, (long)getpid()) == -1) {
+		err(1, "asprintf");
+	}
+	int fd = openat(dirfd, tmp, O_WRONLY | O_CREAT | O_EXCL, 0644);
+	if (fd == -1) {
+		err(1, "open: %s", tmp);
+	}
+	// Keep the permissions of the library that is replaced
+	struct stat st;
+	if (fstatat(dirfd, file, &st, 0) == 0 &&
+	    fchmod(fd, st.st_mode & 07777) == -1) {
+		warn("fchmod: %s", tmp);
+	}
+	for (size_t done = 0; done < h.size;) {
+		ssize_t len = write(fd, buf + done, h.size - done);
+		if (len == -1) {
+			unlinkat(dirfd, tmp, 0);
+			err(1, "write: %s", tmp);
+		}
+		done += len;
+	}
+	if (fsync(fd) == -1 || close(fd) == -1) {
+		unlinkat(dirfd, tmp, 0);
+		err(1, "fsync: %s", tmp);
+	}
+	if (renameat(dirfd, tmp, dirfd, file) == -1) {
+		unlinkat(dirfd, tmp, 0);
+		err(1, "rename: %s", file);
+	}
+	free(tmp);
+	free(buf);
+}
+
+// The cost of clustering m templates around the given medoids: every
+// template counts with its distance to the closest medoid
+static double
+medoid_cost(const double *dist, size_t m, const size_t *medoids, size_t k)
+{
+	double cost = 0.0;
+
+	for (size_t p = 0; p < m; p++) {
+		double closest = HUGE_VAL;
+		for (size_t c = 0; c < k; c++) {
+			closest = MIN(closest, dist[p * m + medoids[c]]);
+		}
+		cost += closest;
+	}
+
+	return cost;
+}
+
+static int
+is_chosen(const size_t *chosen, size_t k, size_t o)
+{
+	for (size_t c = 0; c < k; c++) {
+		if (chosen[c] == o) {
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+// Picks k medoids of the m templates members with a greedy start and
+// swaps that lower the total cost until none is left, and marks them in
+// keep.  Ties go to the template that comes first, so the result only
+// depends on the library.
+static void
+medoids(struct stroke_ws *ws, const struct gesture *gestures,
+    const size_t *members, size_t m, size_t k, int *keep)
+{
+	if (m <= k) {
+		for (size_t i = 0; i < m; i++) {
+			keep[members[i]] = 1;
+		}
+		return;
+	}
+
+	double *dist = reallocarray(NULL, m * m, sizeof(double));
+	size_t *chosen = reallocarray(NULL, k, sizeof(size_t));
+	if (dist == NULL || chosen == NULL) {
+		err(1, "reallocarray");
+	}
+
+	// stroke_compare() is not exactly symmetric
+	for (size_t a = 0; a < m; a++) {
+		const struct stroke_view *va = &gestures[members[a]].stroke;
+		dist[a * m + a] = 0.0;
+		for (size_t b = 0; b < a; b++) {
+			const struct stroke_view *vb =
+			    &gestures[members[b]].stroke;
+			const double d = (stroke_compare_ws(ws, va, vb, NULL,
+			    NULL) + stroke_compare_ws(ws, vb, va, NULL,
+			    NULL)) / 2;
+			dist[a * m + b] = d;
+			dist[b * m + a] = d;
+		}
+	}
+
+	double cost = HUGE_VAL;
+	for (size_t c = 0; c < k; c++) {
+		size_t best = 0;
+		cost = HUGE_VAL;
+		for (size_t o = 0; o < m; o++) {
+			if (is_chosen(chosen, c, o)) {
+				continue;
+			}
+			chosen[c] = o;
+			const double o_cost = medoid_cost(dist, m, chosen,
+			    c + 1);
+			if (o_cost < cost) {
+				cost = o_cost;
+				best = o;
+			}
+		}
+		chosen[c] = best;
+	}
+
+	// Every swap lowers the cost, so this terminates
+	for (int improved = 1; improved;) {
+		improved = 0;
+		for (size_t c = 0; c < k; c++) {
+			for (size_t o = 0; o < m; o++) {
+				const size_t old = chosen[c];
+				chosen[c] = o;
+				const double o_cost = medoid_cost(dist, m,
+				    chosen, k);
+				if (o_cost < cost) {
+					cost = o_cost;
+					improved = 1;
+				} else {
+					chosen[c] = old;
+				}
+			}
+		}
+	}
+
+	for (size_t c = 0; c < k; c++) {
+		keep[members[chosen[c]]] = 1;
+	}
+
+	free(chosen);
+	free(dist);
+}
+
+// Keeps at most k templates of every name, the medoids of a clustering
+// of the name's templates by their stroke_compare() cost.  Recognition
+// then compares against k templates per name, no matter how many
+// samples were recorded.  The remaining gestures keep their order and
+// their number is returned.
+size_t
+library_reduce(struct gesture *gestures, size_t n, size_t k)
+{
+	struct stroke_ws ws;
+	size_t *members = reallocarray(NULL, MAX(1, n), sizeof(size_t));
+	int *seen = calloc(MAX(1, n), sizeof(int));
+	int *keep = calloc(MAX(1, n), sizeof(int));
+	if (members == NULL || seen == NULL || keep == NULL) {
+		err(1, "calloc");
+	}
+
+	stroke_ws_init(&ws);
+	for (size_t i = 0; i < n; i++) {
+		if (seen[i]) {
+			continue;
+		}
+		size_t m = 0;
+		for (size_t j = i; j < n; j++) {
+			if (!seen[j] &&
+			    strcmp(gestures[i].name, gestures[j].name) == 0) {
+				seen[j] = 1;
+				members[m++] = j;
+			}
+		}
+		medoids(&ws, gestures, members, m, k, keep);
+	}
+	stroke_ws_free(&ws);
+
+	size_t kept = 0;
+	for (size_t i = 0; i < n; i++) {
+		if (keep[i]) {
+			gestures[kept++] = gestures[i];
+		}
+	}
+
+	free(keep);
+	free(seen);
+	free(members);
+
+	return kept;
+}
@@ -0,0 +1,77 @@
+/*
+ * Copyright (c) 2020 Tobias Kortkamp <t@tobik.me>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION
+ * OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+#ifndef __LIBRARY_H__
+#define __LIBRARY_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+struct gesture;
+
+/* A gesture library file holds preprocessed templates, laid out so that
+ * it can be used straight from mmap(2).  All integers are in host byte
+ * order and all offsets are in bytes from the start of the file.  Every
+ * section starts at a multiple of 8 bytes:
+ *
+ *	struct library_header
+ *	struct library_entry	entries[ngestures]
+ *	struct stroke_features	features[ngestures]
+ *	stroke_real		t[npoints]
+ *	stroke_real		alpha[npoints]
+ *	char			names[], NUL-terminated, up to the end
+ *
+ * The version changes whenever the layout does.  Files written with the
+ * other byte order or stroke_real type are rejected.
+ */
+#define LIBRARY_MAGIC		"sstroke"
+#define LIBRARY_VERSION		1
+
+struct library_header {
+	char magic[8];
+	uint32_t version;
+	uint32_t real_size;
+	uint32_t ngestures;
+	uint32_t npoints;
+	uint64_t size;
+	uint64_t entries;
+	uint64_t features;
+	uint64_t t;
+	uint64_t alpha;
+	uint64_t names;
+};
+
+// A template's points are t[offset, offset + n) and alpha likewise
+struct library_entry {
+	uint32_t name;
+	uint32_t n;
+	uint32_t offset;
+	uint32_t reserved;
+};
+
+// The gestures' names and strokes point into the mapped file
+struct library {
+	void *map;
+	size_t size;
+	struct gesture *gestures;
+	size_t ngestures;
+};
+
+void library_open(struct library *, const char *);
+void library_close(struct library *);
+void library_write(int, const char *, const struct gesture *, size_t);
+size_t library_reduce(struct gesture *, size_t, size_t);
+
+#endif
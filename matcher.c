@@ -0,0 +1,516 @@
+/*
+ * Copyright (c) 2020 Tobias Kortkamp <t@tobik.me>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION
+ * OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include "config.h"
+
+#if HAVE_ERR
+# include <err.h>
+#endif
+#include <errno.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/param.h>
+
+#include "gestures.h"
+#include "matcher.h"
+#include "stroke.h"
+#include "timing.h"
+
+// Compares gesture i against the stroke, and times it if asked to
+static double
+matcher_compare(struct matcher *m, struct matcher_worker *w, size_t i,
+    double bound)
+{
+	if (!m->timing) {
+		return stroke_compare_bounded(&w->ws, &m->gestures[i].stroke,
+		    m->view, bound, NULL, NULL);
+	}
+
+	const double start = timing_now();
+	const double score = stroke_compare_bounded(&w->ws,
+	    &m->gestures[i].stroke, m->view, bound, NULL, NULL);
+	const double time = timing_now() - start;
+	w->stats.compare_time += time;
+	w->stats.compare_max = MAX(w->stats.compare_max, time);
+	int bin = 0;
+	while (bin < MATCHER_HIST_BINS - 1 && time * 1e6 >= 1 << bin) {
+		bin++;
+	}
+	w->stats.compare_hist[bin]++;
+
+	return score;
+}
+
+// Computes the coarse scores of the worker's share of the gestures
+static void
+matcher_rank(struct matcher *m, struct matcher_worker *w)
+{
+	for (size_t j = w->begin; j < w->end; j++) {
+		const size_t i = m->order[j];
+		w->stats.ranked++;
+		m->coarse_scores[i] = matcher_compare(m, w, i,
+		    stroke_infinity);
+	}
+}
+
+static int
+matcher_result_worse(const struct matcher_result *a,
+    const struct matcher_result *b)
+{
+	return a->score > b->score ||
+	    (a->score == b->score && a->gesture > b->gesture);
+}
+
+static void
+matcher_heap_down(struct matcher_worker *w, size_t i)
+{
+	while (1) {
+		size_t worst = i;
+		for (size_t c = 2 * i + 1; c <= 2 * i + 2 && c < w->nheap;
+		    c++) {
+			if (matcher_result_worse(&w->heap[c],
+			    &w->heap[worst])) {
+				worst = c;
+			}
+		}
+		if (worst == i) {
+			return;
+		}
+		const struct matcher_result tmp = w->heap[i];
+		w->heap[i] = w->heap[worst];
+		w->heap[worst] = tmp;
+		i = worst;
+	}
+}
+
+static void
+matcher_heap_up(struct matcher_worker *w, size_t i)
+{
+	while (i > 0 && matcher_result_worse(&w->heap[i],
+	    &w->heap[(i - 1) / 2])) {
+		const struct matcher_result tmp = w->heap[i];
+		w->heap[i] = w->heap[(i - 1) / 2];
+		w->heap[(i - 1) / 2] = tmp;
+		i = (i - 1) / 2;
+	}
+}
+
+static int
+matcher_same_name(const struct matcher *m, size_t i, size_t j)
+{
+	return strcmp(m->gestures[i].name, m->gestures[j].name) == 0;
+}
+
+// The score that a gesture has to beat to get into the worker's results
+static double
+matcher_bound(const struct matcher *m, const struct matcher_worker *w)
+{
+	return w->nheap < m->top ? stroke_infinity : w->heap[0].score;
+}
+
+// Adds gesture i to the worker's results.  A gesture whose name is
+// already in them only improves that result's score, so the results stay
+// distinct gestures even if a library holds several templates of one.
+static void
+matcher_add(struct matcher *m, struct matcher_worker *w, size_t i,
+    double score)
+{
+	for (size_t j = 0; j < w->nheap; j++) {
+		if (matcher_same_name(m, w->heap[j].gesture, i)) {
+			// Gestures are scanned in order, so an equal score
+			// does not win here
+			if (score < w->heap[j].score) {
+				w->heap[j].gesture = i;
+				w->heap[j].score = score;
+				matcher_heap_down(w, j);
+			}
+			return;
+		}
+	}
+
+	const struct matcher_result r = { i, score };
+	if (w->nheap < m->top) {
+		w->heap[w->nheap] = r;
+		matcher_heap_up(w, w->nheap++);
+	} else {
+		w->heap[0] = r;
+		matcher_heap_down(w, 0);
+	}
+}
+
+// Compares the stroke against the worker's share of the gestures.
+// Gestures whose cheap lower bounds already reach the worst of the best
+// scores so far are skipped before running the DP.
+static void
+matcher_scan(struct matcher *m, struct matcher_worker *w)
+{
+	w->nheap = 0;
+	memset(&w->stats, 0, sizeof(w->stats));
+	w->ws.visited = 0;
+	w->ws.pruned = 0;
+
+	if (m->ranking) {
+		matcher_rank(m, w);
+		return;
+	}
+
+	for (size_t j = w->begin; j < w->end; j++) {
+		const size_t i = m->order[j];
+		const struct gesture *candidate = &m->gestures[i];
+		const double bound = matcher_bound(m, w);
+		w->stats.candidates++;
+		if (stroke_lower_bound_ends(&candidate->stroke, m->view) >=
+		    bound) {
+			w->stats.pruned_ends++;
+			continue;
+		}
+		if (stroke_lower_bound_hist(&candidate->stroke, m->view) >=
+		    bound) {
+			w->stats.pruned_hist++;
+			continue;
+		}
+		w->stats.compared++;
+		double score = matcher_compare(m, w, i, bound);
+		if (score < bound) {
+			// candidate has similarity with stroke and is
+			// among the best so far
+			matcher_add(m, w, i, score);
+		}
+	}
+}
+
+static void *
+matcher_worker_main(void *arg)
+{
+	struct matcher_worker *w = arg;
+	struct matcher *m = w->m;
+	unsigned long generation = 0;
+
+	pthread_mutex_lock(&m->lock);
+	while (1) {
+		while (!m->quit && m->generation == generation) {
+			pthread_cond_wait(&m->start, &m->lock);
+		}
+		if (m->quit) {
+			break;
+		}
+		generation = m->generation;
+		pthread_mutex_unlock(&m->lock);
+
+		matcher_scan(m, w);
+
+		pthread_mutex_lock(&m->lock);
+		if (--m->pending == 0) {
+			pthread_cond_signal(&m->done);
+		}
+	}
+	pthread_mutex_unlock(&m->lock);
+
+	return NULL;
+}
+
+void
+matcher_init(struct matcher *m, const struct gesture *gestures,
+    size_t ngestures, int jobs)
+{
+	m->gestures = gestures;
+	m->ngestures = ngestures;
+	m->jobs = MAX(1, MIN(jobs, (int)MIN(ngestures, INT_MAX)));
+	m->workers = calloc(m->jobs, sizeof(struct matcher_worker));
+	if (m->workers == NULL) {
+		err(1, "calloc");
+	}
+	m->order = reallocarray(NULL, MAX(1, ngestures), sizeof(size_t));
+	m->coarse_scores = reallocarray(NULL, MAX(1, ngestures),
+	    sizeof(double));
+	if (m->order == NULL || m->coarse_scores == NULL) {
+		err(1, "reallocarray");
+	}
+	m->norder = 0;
+	m->ranking = 0;
+	m->level = 0;
+	m->refine = 0;
+	m->timing = 0;
+	m->top = 0;
+	m->results = NULL;
+	m->nresults = 0;
+	m->generation = 0;
+	m->pending = 0;
+	m->quit = 0;
+	m->view = NULL;
+
+	pthread_mutex_init(&m->lock, NULL);
+	pthread_cond_init(&m->start, NULL);
+	pthread_cond_init(&m->done, NULL);
+
+	for (int i = 0; i < m->jobs; i++) {
+		m->workers[i].m = m;
+	}
+	matcher_set_top(m, 1);
+
+	for (int i = 0; i < m->jobs; i++) {
+		struct matcher_worker *w = &m->workers[i];
+		stroke_ws_init(&w->ws);
+		if (i == 0) {
+			continue;
+		}
+		int error = pthread_create(&w->thread, NULL,
+		    matcher_worker_main, w);
+		if (error != 0) {
+			errno = error;
+			err(1, "pthread_create");
+		}
+	}
+}
+
+void
+matcher_free(struct matcher *m)
+{
+	pthread_mutex_lock(&m->lock);
+	m->quit = 1;
+	pthread_cond_broadcast(&m->start);
+	pthread_mutex_unlock(&m->lock);
+
+	for (int i = 0; i < m->jobs; i++) {
+		if (i > 0) {
+			pthread_join(m->workers[i].thread, NULL);
+		}
+		stroke_ws_free(&m->workers[i].ws);
+		free(m->workers[i].heap);
+	}
+	free(m->workers);
+	free(m->results);
+	free(m->coarse_scores);
+	free(m->order);
+
+	pthread_cond_destroy(&m->done);
+	pthread_cond_destroy(&m->start);
+	pthread_mutex_destroy(&m->lock);
+}
+
+// Enables coarse-to-fine matching: all gestures are compared against the
+// stroke's coarse level first, and only the refine best of them against
+// the full stroke.  A level or refine of 0 compares all gestures at full
+// resolution.
+void
+matcher_set_coarse(struct matcher *m, int level, size_t refine)
+{
+	m->level = MAX(0, MIN(level, STROKE_LEVELS));
+	m->refine = refine;
+}
+
+// Makes matcher_match() measure how long each comparison takes.  This
+// costs two clock_gettime() calls per comparison.
+void
+matcher_set_timing(struct matcher *m, int timing)
+{
+	m->timing = timing;
+}
+
+// Makes matcher_match() keep the top best gestures with distinct names
+// in results instead of only the best one.  Every worker keeps its own
+// top results and prunes against the worst of them, which is less
+// effective than pruning against the best score.
+void
+matcher_set_top(struct matcher *m, size_t top)
+{
+	m->top = MAX(1, top);
+	for (int i = 0; i < m->jobs; i++) {
+		struct matcher_worker *w = &m->workers[i];
+		w->heap = reallocarray(w->heap, m->top,
+		    sizeof(struct matcher_result));
+		if (w->heap == NULL) {
+			err(1, "reallocarray");
+		}
+		w->nheap = 0;
+	}
+	m->results = reallocarray(m->results, m->top * m->jobs,
+	    sizeof(struct matcher_result));
+	if (m->results == NULL) {
+		err(1, "reallocarray");
+	}
+	m->nresults = 0;
+}
+
+// Runs one pass over order[0, norder) on all workers and adds up their
+// stats.
+static void
+matcher_run(struct matcher *m)
+{
+	for (int i = 0; i < m->jobs; i++) {
+		m->workers[i].begin = m->norder * i / m->jobs;
+		m->workers[i].end = m->norder * (i + 1) / m->jobs;
+	}
+
+	if (m->jobs > 1) {
+		pthread_mutex_lock(&m->lock);
+		m->pending = m->jobs - 1;
+		m->generation++;
+		pthread_cond_broadcast(&m->start);
+		pthread_mutex_unlock(&m->lock);
+	}
+
+	matcher_scan(m, &m->workers[0]);
+
+	if (m->jobs > 1) {
+		pthread_mutex_lock(&m->lock);
+		while (m->pending > 0) {
+			pthread_cond_wait(&m->done, &m->lock);
+		}
+		pthread_mutex_unlock(&m->lock);
+	}
+
+	for (int i = 0; i < m->jobs; i++) {
+		const struct matcher_worker *w = &m->workers[i];
+		m->stats.ranked += w->stats.ranked;
+		m->stats.candidates += w->stats.candidates;
+		m->stats.pruned_ends += w->stats.pruned_ends;
+		m->stats.pruned_hist += w->stats.pruned_hist;
+		m->stats.compared += w->stats.compared;
+		m->stats.visited += w->ws.visited;
+		m->stats.pruned += w->ws.pruned;
+		m->stats.compare_time += w->stats.compare_time;
+		m->stats.compare_max = MAX(m->stats.compare_max,
+		    w->stats.compare_max);
+		for (int b = 0; b < MATCHER_HIST_BINS; b++) {
+			m->stats.compare_hist[b] += w->stats.compare_hist[b];
+		}
+	}
+}
+
+static int
+matcher_ranks_before(const struct matcher *m, size_t i, size_t j)
+{
+	return m->coarse_scores[i] < m->coarse_scores[j] ||
+	    (m->coarse_scores[i] == m->coarse_scores[j] && i < j);
+}
+
+// Moves the refine gestures with the best coarse scores to the front of
+// order, sorted by index so that ties still go to the first gesture
+static void
+matcher_select(struct matcher *m)
+{
+	const size_t k = m->refine;
+
+	for (size_t j = 0; j < k; j++) {
+		size_t best = j;
+		for (size_t l = j + 1; l < m->norder; l++) {
+			if (matcher_ranks_before(m, m->order[l],
+			    m->order[best])) {
+				best = l;
+			}
+		}
+		const size_t tmp = m->order[j];
+		m->order[j] = m->order[best];
+		m->order[best] = tmp;
+	}
+	for (size_t j = 1; j < k; j++) {
+		const size_t i = m->order[j];
+		size_t l = j;
+		for (; l > 0 && m->order[l - 1] > i; l--) {
+			m->order[l] = m->order[l - 1];
+		}
+		m->order[l] = i;
+	}
+	m->norder = k;
+}
+
+static int
+matcher_result_compare(const void *a, const void *b)
+{
+	const struct matcher_result *ra = a;
+	const struct matcher_result *rb = b;
+
+	if (matcher_result_worse(ra, rb)) {
+		return 1;
+	}
+	return matcher_result_worse(rb, ra) ? -1 : 0;
+}
+
+// Merges the workers' results into results, sorted by score and then
+// index.  Every worker has the best score of each name in its share
+// unless top better names keep it out, so dropping the later results of
+// a name leaves the best top results overall.
+static void
+matcher_merge(struct matcher *m)
+{
+	m->nresults = 0;
+	for (int i = 0; i < m->jobs; i++) {
+		const struct matcher_worker *w = &m->workers[i];
+		memcpy(&m->results[m->nresults], w->heap,
+		    w->nheap * sizeof(struct matcher_result));
+		m->nresults += w->nheap;
+	}
+	qsort(m->results, m->nresults, sizeof(struct matcher_result),
+	    matcher_result_compare);
+
+	size_t n = 0;
+	for (size_t i = 0; i < m->nresults && n < m->top; i++) {
+		size_t j = 0;
+		while (j < n && !matcher_same_name(m, m->results[j].gesture,
+		    m->results[i].gesture)) {
+			j++;
+		}
+		if (j == n) {
+			m->results[n++] = m->results[i];
+		}
+	}
+	m->nresults = n;
+}
+
+// Returns the gesture most similar to stroke or NULL if there is none.
+// The gestures are compared in place, nothing is copied.  Ties go to the
+// gesture that comes first, no matter how many jobs are used.  See
+// matcher_set_top() for the runners-up.
+const struct gesture *
+matcher_match(struct matcher *m, const struct stroke *stroke)
+{
+	memset(&m->stats, 0, sizeof(m->stats));
+	m->nresults = 0;
+	if (stroke->n < 2) {
+		return NULL;
+	}
+
+	for (size_t i = 0; i < m->ngestures; i++) {
+		m->order[i] = i;
+	}
+	m->norder = m->ngestures;
+
+	if (m->level > 0 && m->refine > 0 && m->refine < m->ngestures) {
+		struct stroke_view coarse;
+		stroke_get_level_view(stroke, m->level, &coarse);
+		m->view = &coarse;
+		m->ranking = 1;
+		matcher_run(m);
+		m->ranking = 0;
+		matcher_select(m);
+	}
+
+	struct stroke_view view;
+	stroke_get_view(stroke, &view);
+	m->view = &view;
+	matcher_run(m);
+	matcher_merge(m);
+	m->view = NULL;
+
+	if (m->nresults == 0) {
+		return NULL;
+	}
+	return &m->gestures[m->results[0].gesture];
+}
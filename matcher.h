@@ -0,0 +1,117 @@
+/*
+ * Copyright (c) 2020 Tobias Kortkamp <t@tobik.me>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION
+ * OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+#ifndef __MATCHER_H__
+#define __MATCHER_H__
+
+#include <pthread.h>
+
+#include "stroke.h"
+
+struct gesture;
+struct matcher;
+
+// How many gestures each stage of the last matcher_match() dropped.
+// Only the gestures left after both lower bounds get the full DP.
+// ranked counts the comparisons at the coarse level, if any.  visited and
+// pruned are the DP cells of all comparisons, see struct stroke_ws.  The
+// time in seconds that the comparisons took in total and at most is only
+// measured after matcher_set_timing().  compare_hist[b] then counts the
+// comparisons that took less than 2^b microseconds but not less than
+// 2^(b-1), the last bin also the slower ones.
+#define MATCHER_HIST_BINS	12
+
+struct matcher_stats {
+	unsigned long ranked;
+	unsigned long candidates;
+	unsigned long pruned_ends;
+	unsigned long pruned_hist;
+	unsigned long compared;
+	unsigned long visited;
+	unsigned long pruned;
+	double compare_time;
+	double compare_max;
+	unsigned long compare_hist[MATCHER_HIST_BINS];
+};
+
+// A gesture, as an index into the matcher's gestures, and its cost
+struct matcher_result {
+	size_t gesture;
+	double score;
+};
+
+// Each worker compares the stroke against the gestures in
+// order[begin, end) of the current pass.  It keeps its best results in
+// a max-heap, so that the worst of them is at the root.
+struct matcher_worker {
+	struct matcher *m;
+	pthread_t thread;
+	struct stroke_ws ws;
+	size_t begin;
+	size_t end;
+	struct matcher_result *heap;
+	size_t nheap;
+	struct matcher_stats stats;
+};
+
+/* The gestures are split evenly across jobs workers.  The first worker
+ * runs in the calling thread, the others in a pool of threads that is
+ * started by matcher_init() and woken up for every matcher_match().
+ */
+struct matcher {
+	const struct gesture *gestures;
+	size_t ngestures;
+	int jobs;
+	struct matcher_worker *workers;
+
+	pthread_mutex_t lock;
+	pthread_cond_t start;
+	pthread_cond_t done;
+	unsigned long generation;
+	int pending;
+	int quit;
+	const struct stroke_view *view;
+
+	// The gestures that the current pass looks at, and whether it
+	// only ranks them by their coarse score
+	size_t *order;
+	size_t norder;
+	int ranking;
+	double *coarse_scores;
+
+	// See matcher_set_coarse()
+	int level;
+	size_t refine;
+
+	int timing;
+
+	// The best results of the last matcher_match(), at most top of
+	// them and each with another name, sorted by score.  The array has
+	// room for the results of all workers.
+	size_t top;
+	struct matcher_result *results;
+	size_t nresults;
+
+	struct matcher_stats stats;
+};
+
+void matcher_init(struct matcher *, const struct gesture *, size_t, int);
+void matcher_free(struct matcher *);
+void matcher_set_coarse(struct matcher *, int, size_t);
+void matcher_set_timing(struct matcher *, int);
+void matcher_set_top(struct matcher *, size_t);
+const struct gesture *matcher_match(struct matcher *, const struct stroke *);
+
+#endif
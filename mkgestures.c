@@ -0,0 +1,98 @@
+/*
+ * Copyright (c) 2020 Tobias Kortkamp <t@tobik.me>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION
+ * OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include "config.h"
+
+#if HAVE_ERR
+# include <err.h>
+#endif
+#include <stdio.h>
+
+#include "default_gestures.h"
+#include "stroke.h"
+
+static struct stroke strokes[NoGesture];
+
+static void
+print_pool(const char *name, int alpha)
+{
+	printf("static const stroke_real %s[] = {\n", name);
+	for (size_t i = 0; i < NoGesture; i++) {
+		printf("\t// %s\n", default_gestures[i].name);
+		for (int j = 0; j < strokes[i].n; j++) {
+			printf("\t%a,\n", alpha ? strokes[i].alpha[j] :
+			    strokes[i].t[j]);
+		}
+	}
+	printf("};\n\n");
+}
+
+static void
+print_features(void)
+{
+	printf("static const struct stroke_features gesture_features[] = {\n");
+	for (size_t i = 0; i < NoGesture; i++) {
+		const struct stroke_features *f = &strokes[i].features;
+		printf("\t// %s\n", default_gestures[i].name);
+		printf("\t{ {");
+		for (int k = 0; k < STROKE_BINS; k++) {
+			printf("%s%a", k % 4 == 0 ? "\n\t\t" : " ", f->hist[k]);
+			printf(k + 1 < STROKE_BINS ? "," : "\n\t},\n");
+		}
+		printf("\t\t%a, %a,\n", f->start_alpha, f->start_t);
+		printf("\t\t%a, %a },\n", f->end_alpha, f->end_t);
+	}
+	printf("};\n\n");
+}
+
+// Runs stroke_finish() over the default gestures and prints the results
+// as C source, so that simplestroke does not have to do it on every start.
+// Values are printed in hexadecimal to keep them exact.
+int
+main(void)
+{
+	for (size_t i = 0; i < NoGesture; i++) {
+		const struct default_point *p = default_gestures[i].p;
+		for (size_t j = 0; j < default_gestures[i].n; j++) {
+			stroke_add_point(&strokes[i], p[j].x, p[j].y);
+		}
+		stroke_finish(&strokes[i]);
+	}
+
+	printf("/* Generated by mkgestures, regenerate with make "
+	    "update-gestures. */\n\n");
+	printf("#include \"config.h\"\n\n");
+	printf("#include \"gestures.h\"\n\n");
+	print_pool("gesture_t", 0);
+	print_pool("gesture_alpha", 1);
+	print_features();
+	printf("const struct gesture gestures[] = {\n");
+	size_t off = 0;
+	for (size_t i = 0; i < NoGesture; i++) {
+		printf("\t{ \"%s\", { %d, &gesture_t[%zu], "
+		    "&gesture_alpha[%zu],\n\t    &gesture_features[%zu] } },\n",
+		    default_gestures[i].name, strokes[i].n, off, off, i);
+		off += strokes[i].n;
+	}
+	printf("};\n\n");
+	printf("const size_t ngestures = %d;\n", NoGesture);
+
+	if (fflush(stdout) == EOF) {
+		err(1, "fflush");
+	}
+
+	return 0;
+}
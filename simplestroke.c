@@ -19,240 +19,525 @@
 #if HAVE_ERR
 # include <err.h>
 #endif
+#include <sys/param.h>
+#include <sys/stat.h>
+#include <fcntl.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <sysexits.h>
 #include <unistd.h>
 
+#include "gestures.h"
+#include "library.h"
+#include "matcher.h"
 #include "stroke.h"
+#include "timing.h"
 #include "tracker.h"
 
-enum Gesture {
-	// straight line gestures
-	TopDown,
-	DownTop,
-	LeftRight,
-	RightLeft,
+// Milliseconds without motion after which the stroke is matched
+// speculatively, before the button is released, with -s
+#define SPECULATE_TIMEOUT	20
 
-	// Diagonal line gestures
-	TopLeftDown,
-	TopRightDown,
-	DownLeftTop,
-	DownRightTop,
+enum output_format {
+	OUTPUT_NAME,
+	OUTPUT_TSV,
+	OUTPUT_JSON,
+};
 
-	// 'z' line gestures
-	LeftZ,  // a z starting from the left
-	RightZ, // a mirrored z starting from the right
+// The last stroke that was matched during a pause while it was drawn.
+// hit is set if match() could use it.
+static struct {
+	int valid;
+	int hit;
+	struct stroke stroke;
+	const struct gesture *gesture;
+} speculation;
 
-	SquareLeft,
-	SquareRight,
+static void
+speculate(const struct stroke *stroke, void *arg)
+{
+	struct matcher *matcher = arg;
 
-	ArrowDown,
-	ArrowUp,
-	ArrowLeft,
-	ArrowRight,
+	speculation.stroke = *stroke;
+	stroke_finish(&speculation.stroke);
+	speculation.gesture = matcher_match(matcher, &speculation.stroke);
+	speculation.valid = 1;
+}
 
-	NoGesture
-};
+// Normally the pointer rests before the button is released, so the
+// stroke has already been matched by speculate().  Finishing a stroke
+// is deterministic, so equal t and alpha mean equal input.
+static const struct gesture *
+match(struct matcher *matcher, const struct stroke *stroke)
+{
+	const int hit = speculation.valid &&
+	    speculation.stroke.n == stroke->n &&
+	    memcmp(speculation.stroke.t, stroke->t,
+	    stroke->n * sizeof(stroke->t[0])) == 0 &&
+	    memcmp(speculation.stroke.alpha, stroke->alpha,
+	    stroke->n * sizeof(stroke->alpha[0])) == 0;
 
-struct {
-	const char *name;
-	size_t n;
-	struct {
-		double x;
-		double y;
-	} p[MAX_STROKE_POINTS];
-} default_gestures[] = {
-	[TopDown] = { "TopDown", 3, {
-		{ 0.5, 0.0 },
-		{ 0.5, 0.5 },
-		{ 0.5, 1.0 },
-	} },
-	[DownTop] = { "DownTop", 3, {
-		{ 0.5, 1.0 },
-		{ 0.5, 0.5 },
-		{ 0.5, 0.0 },
-	} },
-	[LeftRight] = { "LeftRight", 3, {
-		{ 0.0, 0.5 },
-		{ 0.5, 0.5 },
-		{ 1.0, 0.5 },
-	} },
-	[RightLeft] = { "RightLeft", 3, {
-		{ 1.0, 0.5 },
-		{ 0.5, 0.5 },
-		{ 0.0, 0.5 },
-	} },
-
-	[TopLeftDown] = { "TopLeftDown", 3, {
-		{ 0.0, 0.0 },
-		{ 0.5, 0.5 },
-		{ 1.0, 1.0 },
-	} },
-	[TopRightDown] = { "TopRightDown", 3, {
-		{ 1.0, 0.0 },
-		{ 0.5, 0.5 },
-		{ 0.0, 1.0 },
-	} },
-	[DownLeftTop] = { "DownLeftTop", 3, {
-		{ 1.0, 1.0 },
-		{ 0.5, 0.5 },
-		{ 0.0, 0.0 },
-	} },
-	[DownRightTop] = { "DownRightTop", 3, {
-		{ 0.0, 1.0 },
-		{ 0.5, 0.5 },
-		{ 1.0, 0.0 },
-	} },
-
-	[LeftZ] = { "LeftZ", 9, {
-		{ 0.0, 0.0 },
-		{ 0.5, 0.0 },
-		{ 1.0, 0.0 },
-		{ 0.75, 0.25 },
-		{ 0.5, 0.5 },
-		{ 0.25, 0.75 },
-		{ 0.0, 1.0 },
-		{ 0.5, 1.0 },
-		{ 1.0, 1.0 },
-	} },
-	[RightZ] = { "RightZ", 9, {
-		{ 1.0, 1.0 },
-		{ 0.5, 1.0 },
-		{ 0.0, 1.0 },
-		{ 0.25, 0.75 },
-		{ 0.5, 0.5 },
-		{ 0.75, 0.25 },
-		{ 1.0, 0.0 },
-		{ 0.5, 0.0 },
-		{ 0.0, 0.0 },
-	} },
-
-	[SquareLeft] = { "SquareLeft", 9, {
-		{ 0.0, 0.0 },
-		{ 0.5, 0.0 },
-		{ 1.0, 0.0 },
-		{ 1.0, 0.5 },
-		{ 1.0, 1.0 },
-		{ 0.5, 1.0 },
-		{ 0.0, 1.0 },
-		{ 0.0, 0.5 },
-		{ 0.0, 0.0 },
-	} },
-	[SquareRight] = { "SquareRight", 9, {
-		{ 0.0, 0.0 },
-		{ 0.0, 0.5 },
-		{ 0.0, 1.0 },
-		{ 0.5, 1.0 },
-		{ 1.0, 1.0 },
-		{ 1.0, 0.5 },
-		{ 1.0, 0.0 },
-		{ 0.5, 0.0 },
-		{ 0.0, 0.0 },
-	} },
-
-	[ArrowDown] = { "ArrowDown", 11, { // v
-		{ 0.0, 0.0 },
-		{ 0.1, 0.2 },
-		{ 0.2, 0.4 },
-		{ 0.3, 0.6 },
-		{ 0.4, 0.8 },
-		{ 0.5, 1.0 },
-		{ 0.6, 0.8 },
-		{ 0.7, 0.6 },
-		{ 0.8, 0.4 },
-		{ 0.9, 0.2 },
-		{ 1.0, 0.0 },
-	} },
-	[ArrowUp] = { "ArrowUp", 11, { // ^
-		{ 0.0, 1.0 },
-		{ 0.1, 0.8 },
-		{ 0.2, 0.6 },
-		{ 0.3, 0.4 },
-		{ 0.4, 0.2 },
-		{ 0.5, 0.0 },
-		{ 0.6, 0.2 },
-		{ 0.7, 0.4 },
-		{ 0.8, 0.6 },
-		{ 0.9, 0.8 },
-		{ 1.0, 1.0 },
-	} },
-	[ArrowLeft] = { "ArrowLeft", 11, { // <
-		{ 1.0, 0.0 },
-		{ 0.8, 0.1 },
-		{ 0.6, 0.2 },
-		{ 0.4, 0.3 },
-		{ 0.2, 0.4 },
-		{ 0.0, 0.5 },
-		{ 0.2, 0.6 },
-		{ 0.4, 0.7 },
-		{ 0.6, 0.8 },
-		{ 0.8, 0.9 },
-		{ 1.0, 1.0 },
-	} },
-	[ArrowRight] = { "ArrowRight", 11, { // >
-		{ 0.0, 0.0 },
-		{ 0.2, 0.1 },
-		{ 0.4, 0.2 },
-		{ 0.6, 0.3 },
-		{ 0.8, 0.4 },
-		{ 1.0, 0.5 },
-		{ 0.8, 0.6 },
-		{ 0.6, 0.7 },
-		{ 0.4, 0.8 },
-		{ 0.2, 0.9 },
-		{ 0.0, 1.0 },
-	} },
-};
+	speculation.valid = 0;
+	speculation.hit = hit;
+	if (hit) {
+		return speculation.gesture;
+	}
+	return matcher_match(matcher, stroke);
+}
 
-static struct stroke strokes[NoGesture];
-static void init_gestures(void);
+// Prints to stderr where the time of the last recognition went.  The
+// matcher's numbers are those of the speculative match if it was used.
+static void
+report(const struct stroke *stroke, const struct matcher *matcher,
+    double match_time)
+{
+	const struct tracker_stats *ts = tracker_stats();
+	const struct matcher_stats *ms = &matcher->stats;
+
+	fprintf(stderr, "capture %.1f us, %lu events, %lu syscalls, "
+	    "%lu idle, %d points\n", ts->capture * 1e6, ts->events,
+	    ts->syscalls, ts->idle, stroke->n);
+	fprintf(stderr, "finish %.1f us\n", ts->finish * 1e6);
+	fprintf(stderr, "match %.1f us%s, %lu ranked, %lu candidates, "
+	    "%lu pruned, %lu compared\n", match_time * 1e6,
+	    speculation.hit ? " (speculated)" : "", ms->ranked,
+	    ms->candidates, ms->pruned_ends + ms->pruned_hist,
+	    ms->compared);
+	const unsigned long calls = ms->ranked + ms->compared;
+	fprintf(stderr, "compare %lu calls, %.1f us mean, %.1f us max, "
+	    "%.1f us total, %lu cells visited, %lu pruned\n", calls,
+	    calls > 0 ? ms->compare_time * 1e6 / calls : 0.0,
+	    ms->compare_max * 1e6, ms->compare_time * 1e6, ms->visited,
+	    ms->pruned);
+	fprintf(stderr, "compare us");
+	for (int b = 0; b < MATCHER_HIST_BINS; b++) {
+		if (ms->compare_hist[b] == 0) {
+			continue;
+		}
+		if (b < MATCHER_HIST_BINS - 1) {
+			fprintf(stderr, " <%d:%lu", 1 << b,
+			    ms->compare_hist[b]);
+		} else {
+			fprintf(stderr, " >=%d:%lu", 1 << (b - 1),
+			    ms->compare_hist[b]);
+		}
+	}
+	fprintf(stderr, "\n");
+}
 
-void
-init_gestures()
+// Returns the length of the valid UTF-8 sequence of a non-ASCII
+// character at s, or 0 if there is none
+static size_t
+utf8_length(const unsigned char *s)
 {
-	for (size_t i = 0; i < NoGesture; i++) {
-		for (size_t j = 0; j < default_gestures[i].n; j++) {
-			double x = default_gestures[i].p[j].x;
-			double y = default_gestures[i].p[j].y;
-			stroke_add_point(&strokes[i], x, y);
+	size_t len;
+	unsigned long c;
+
+	if (s[0] >= 0xc2 && s[0] <= 0xdf) {
+		len = 2;
+		c = s[0] & 0x1f;
+	} else if (s[0] >= 0xe0 && s[0] <= 0xef) {
+		len = 3;
+		c = s[0] & 0x0f;
+	} else if (s[0] >= 0xf0 && s[0] <= 0xf4) {
+		len = 4;
+		c = s[0] & 0x07;
+	} else {
+		return 0;
+	}
+	for (size_t i = 1; i < len; i++) {
+		if ((s[i] & 0xc0) != 0x80) {
+			return 0;
 		}
-		stroke_finish(&strokes[i]);
+		c = c << 6 | (s[i] & 0x3f);
 	}
+	// Overlong forms, surrogates and what is beyond Unicode
+	if ((len == 3 && (c < 0x800 || (c >= 0xd800 && c <= 0xdfff))) ||
+	    (len == 4 && (c < 0x10000 || c > 0x10ffff))) {
+		return 0;
+	}
+
+	return len;
+}
+
+// Names come from library files, so they are not necessarily valid
+// UTF-8.  Invalid bytes are replaced with U+FFFD.
+static void
+print_json_string(const char *name)
+{
+	const unsigned char *s = (const unsigned char *)name;
+
+	putchar('"');
+	while (*s != '\0') {
+		if (*s == '"' || *s == '\\') {
+			printf("\\%c", *s++);
+		} else if (*s < 0x20 || *s == 0x7f) {
+			printf("\\u%04x", *s++);
+		} else if (*s < 0x80) {
+			putchar(*s++);
+		} else {
+			const size_t len = utf8_length(s);
+			if (len == 0) {
+				printf("\\ufffd");
+				s++;
+			} else {
+				fwrite(s, 1, len, stdout);
+				s += len;
+			}
+		}
+	}
+	putchar('"');
+}
+
+// Prints the recognized gesture as one line, empty if there is none.
+// The name alone is printed without a trailing newline.  The other
+// formats print the matcher's best results with their costs, either as
+// tab-separated name and cost pairs or as a JSON array.  After a
+// speculative match the matcher still holds the speculative results.
+static void
+print_result(const struct matcher *matcher, const struct gesture *gesture,
+    enum output_format format)
+{
+	switch (format) {
+		case OUTPUT_NAME:
+			if (gesture != NULL) {
+				printf("%s", gesture->name);
+			}
+			break;
+		case OUTPUT_TSV:
+			for (size_t i = 0; i < matcher->nresults; i++) {
+				const struct matcher_result *r =
+				    &matcher->results[i];
+				printf("%s%s\t%.6g", i > 0 ? "\t" : "",
+				    matcher->gestures[r->gesture].name,
+				    r->score);
+			}
+			break;
+		case OUTPUT_JSON:
+			putchar('[');
+			for (size_t i = 0; i < matcher->nresults; i++) {
+				const struct matcher_result *r =
+				    &matcher->results[i];
+				printf("%s{\"name\":", i > 0 ? "," : "");
+				print_json_string(
+				    matcher->gestures[r->gesture].name);
+				printf(",\"score\":%.6g}", r->score);
+			}
+			putchar(']');
+			break;
+	}
+}
+
+// Records samples strokes of name, if any, in place of the gesture's
+// previous templates.  The templates are stored at the resolution of the
+// first coarse level.  Then reduces every gesture to at most medoids
+// templates, if asked to, and replaces the library file file in the
+// directory dirfd.
+static int
+edit_library(const struct library *library, int dirfd, const char *file,
+    const char *name, int samples, size_t medoids)
+{
+	struct stroke *strokes = reallocarray(NULL, samples,
+	    sizeof(struct stroke));
+	struct gesture *templates = reallocarray(NULL,
+	    library->ngestures + samples, sizeof(struct gesture));
+	if (strokes == NULL || templates == NULL) {
+		err(1, "reallocarray");
+	}
+
+	size_t n = 0;
+	for (size_t i = 0; i < library->ngestures; i++) {
+		if (name == NULL ||
+		    strcmp(library->gestures[i].name, name) != 0) {
+			templates[n++] = library->gestures[i];
+		}
+	}
+
+	int ok = 1;
+	for (int i = 0; name != NULL && i < samples;) {
+		fprintf(stderr, "%s: press a button, draw sample %d of %d and "
+		    "release it\n", name, i + 1, samples);
+		// The first call waits for the button press
+		if (!tracker_record_stroke(NULL) ||
+		    !tracker_record_stroke(&strokes[i])) {
+			ok = 0;
+			break;
+		}
+		if (strokes[i].n < 2) {
+			fprintf(stderr, "%s: too short, try again\n", name);
+			continue;
+		}
+		templates[n].name = name;
+		stroke_get_level_view(&strokes[i], 1, &templates[n].stroke);
+		n++;
+		i++;
+	}
+
+	if (ok) {
+		if (medoids > 0) {
+			n = library_reduce(templates, n, medoids);
+		}
+		library_write(dirfd, file, templates, n);
+	}
+	free(templates);
+	free(strokes);
+
+	return ok;
+}
+
+// Opens the directory that path is in and points file at path's last
+// component
+static int
+open_parent(const char *path, const char **file)
+{
+	const char *slash = strrchr(path, '/');
+	char *dir = slash == NULL ? strdup(".") :
+	    strndup(path, MAX(1, slash - path));
+	if (dir == NULL) {
+		err(1, "strdup");
+	}
+	*file = slash == NULL ? path : slash + 1;
+	if (**file == '\0') {
+		errx(EX_USAGE, "not a file: %s", path);
+	}
+
+	int fd = open(dir, O_RDONLY | O_DIRECTORY);
+	if (fd == -1) {
+		err(1, "open: %s", dir);
+	}
+	// Fail now and not after recording all samples
+	if (access(dir, W_OK) == -1) {
+		err(1, "%s", dir);
+	}
+	free(dir);
+
+	return fd;
+}
+
+static void
+usage(void)
+{
+	fprintf(stderr, "usage: simplestroke [-dstv] [-c count] [-e events] "
+	    "[-f file] [-j jobs]\n"
+	    "                    [-k count] [-o tsv | json]\n"
+	    "       simplestroke -f file [-m medoids] [-r name [-n samples]]"
+	    "\n");
+	exit(EX_USAGE);
 }
 
 int
 main(int argc, char *argv[])
 {
-	tracker_init(NULL);
+	int ch;
+	int daemon_mode = 0;
+	int jobs = 1;
+	size_t refine = 0;
+	const char *library_path = NULL;
+	const char *replay_path = NULL;
+	int realtime = 0;
+	int speculative = 0;
+	const char *record_name = NULL;
+	int samples = 1;
+	size_t medoids = 0;
+	int verbose = 0;
+	size_t top = 0;
+	enum output_format format = OUTPUT_NAME;
+	const char *errstr;
+	while ((ch = getopt(argc, argv, "c:de:f:j:k:m:n:o:r:stv")) != -1) {
+		switch (ch) {
+			case 'c':
+				refine = strtonum(optarg, 1, 1024, &errstr);
+				if (errstr != NULL) {
+					errx(EX_USAGE, "count is %s: %s",
+					    errstr, optarg);
+				}
+				break;
+			case 'd':
+				daemon_mode = 1;
+				break;
+			case 'e':
+				replay_path = optarg;
+				break;
+			case 'f':
+				library_path = optarg;
+				break;
+			case 'j':
+				jobs = strtonum(optarg, 1, 256, &errstr);
+				if (errstr != NULL) {
+					errx(EX_USAGE, "jobs is %s: %s", errstr,
+					    optarg);
+				}
+				break;
+			case 'k':
+				top = strtonum(optarg, 1, 64, &errstr);
+				if (errstr != NULL) {
+					errx(EX_USAGE, "count is %s: %s",
+					    errstr, optarg);
+				}
+				break;
+			case 'm':
+				medoids = strtonum(optarg, 1, 1024, &errstr);
+				if (errstr != NULL) {
+					errx(EX_USAGE, "medoids is %s: %s",
+					    errstr, optarg);
+				}
+				break;
+			case 'n':
+				samples = strtonum(optarg, 1, 64, &errstr);
+				if (errstr != NULL) {
+					errx(EX_USAGE, "samples is %s: %s",
+					    errstr, optarg);
+				}
+				break;
+			case 'o':
+				if (strcmp(optarg, "tsv") == 0) {
+					format = OUTPUT_TSV;
+				} else if (strcmp(optarg, "json") == 0) {
+					format = OUTPUT_JSON;
+				} else {
+					errx(EX_USAGE, "unknown format: %s",
+					    optarg);
+				}
+				break;
+			case 'r':
+				record_name = optarg;
+				if (*record_name == '\0' ||
+				    strpbrk(record_name, "\t\n") != NULL) {
+					errx(EX_USAGE, "invalid name: %s",
+					    record_name);
+				}
+				break;
+			case 's':
+				speculative = 1;
+				break;
+			case 't':
+				realtime = 1;
+				break;
+			case 'v':
+				verbose = 1;
+				break;
+			default:
+				usage();
+		}
+	}
+	argc -= optind;
+	argv += optind;
+	if (top > 0 && format == OUTPUT_NAME) {
+		format = OUTPUT_TSV;
+	}
+	const int edit = record_name != NULL || medoids > 0;
+	if (argc > 0 || (edit && (library_path == NULL || daemon_mode))) {
+		usage();
+	}
 
-	struct stroke stroke;
-	if (!tracker_record_stroke(&stroke)) {
-		return 1;
+	if (replay_path != NULL) {
+		tracker_set_replay(replay_path, realtime);
 	}
 
-	init_gestures();
-
-	enum Gesture gesture = NoGesture;
-	double best_score = stroke_infinity;
-	for (size_t i = 0; i < NoGesture; i++) {
-		struct stroke candidate = strokes[i];
-		double score = stroke_compare(&candidate, &stroke, NULL, NULL);
-		if (score < stroke_infinity) {
-			// candidate has similarity with stroke
-			if (score < best_score) {
-				// there is a better candidate
-				best_score = score;
-				gesture = i;
-			}
+	// The library has to be opened before the tracker enters the
+	// sandbox.  The new library is written through its directory,
+	// which stays open in the sandbox.
+	struct library library = { NULL, 0, NULL, 0 };
+	if (edit) {
+		struct stat st;
+		const char *file;
+		const int dirfd = open_parent(library_path, &file);
+		if (record_name == NULL ||
+		    (stat(library_path, &st) == 0 && st.st_size > 0)) {
+			library_open(&library, library_path);
 		}
+		if (record_name != NULL) {
+			tracker_keep_fd(dirfd);
+			tracker_init(NULL, 0);
+		}
+		const int ok = edit_library(&library, dirfd, file,
+		    record_name, samples, medoids);
+		if (library.map != NULL) {
+			library_close(&library);
+		}
+		close(dirfd);
+		return ok ? 0 : 1;
+	}
+
+	const struct gesture *templates = gestures;
+	size_t ntemplates = ngestures;
+	if (library_path != NULL) {
+		library_open(&library, library_path);
+		templates = library.gestures;
+		ntemplates = library.ngestures;
+	}
+
+	const double init_start = timing_now();
+	tracker_init(NULL, daemon_mode ? TRACKER_KEEP_STDIN : 0);
+	if (verbose) {
+		fprintf(stderr, "init %.1f us\n",
+		    (timing_now() - init_start) * 1e6);
 	}
 
-	if (gesture != NoGesture) {
-		printf("%s\n", default_gestures[gesture].name);
+	struct matcher matcher;
+	matcher_init(&matcher, templates, ntemplates, jobs);
+	if (refine > 0) {
+		matcher_set_coarse(&matcher, 1, refine);
+	}
+	matcher_set_timing(&matcher, verbose);
+	if (top > 0) {
+		matcher_set_top(&matcher, top);
+	}
+	if (speculative) {
+		tracker_set_idle_handler(SPECULATE_TIMEOUT, speculate,
+		    &matcher);
+	}
+	static struct stroke stroke;
+
+	if (daemon_mode) {
+		// Recognize one stroke for every line read from stdin and
+		// answer with one line each, empty if nothing was recognized
+		char *line = NULL;
+		size_t linecap = 0;
+		while (getline(&line, &linecap, stdin) > 0) {
+			tracker_flush();
+			speculation.valid = 0;
+			if (!tracker_record_stroke(&stroke)) {
+				break;
+			}
+			const double start = timing_now();
+			const struct gesture *gesture =
+			    match(&matcher, &stroke);
+			if (verbose) {
+				report(&stroke, &matcher, timing_now() - start);
+			}
+			print_result(&matcher, gesture, format);
+			printf("\n");
+			if (fflush(stdout) == EOF) {
+				err(1, "fflush");
+			}
+		}
+		free(line);
+		matcher_free(&matcher);
+		if (library_path != NULL) {
+			library_close(&library);
+		}
 		return 0;
 	}
 
-	return 1;
+	if (!tracker_record_stroke(&stroke)) {
+		return 1;
+	}
+
+	const double start = timing_now();
+	const struct gesture *gesture = match(&matcher, &stroke);
+	if (verbose) {
+		report(&stroke, &matcher, timing_now() - start);
+	}
+	if (gesture != NULL || format != OUTPUT_NAME) {
+		print_result(&matcher, gesture, format);
+		printf("\n");
+	}
+	matcher_free(&matcher);
+	if (library_path != NULL) {
+		library_close(&library);
+	}
+
+	return gesture != NULL ? 0 : 1;
 }
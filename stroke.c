@@ -18,7 +18,11 @@
 #include "config.h"
 
 #include <assert.h>
+#if HAVE_ERR
+# include <err.h>
+#endif
 #include <math.h>
+#include <stdlib.h>
 #include <string.h>
 #include <sys/param.h>
 
@@ -31,16 +35,134 @@
 const double stroke_infinity = 0.2;
 static const double epsilon = 0.000001;
 
+/* Drops every other point but the first and the last one, and sets the
+ * spacing to the average distance between the remaining points.
+ */
+static void
+stroke_decimate(struct stroke *s)
+{
+	const int last = s->n - 1;
+	double length = 0.0;
+	int n = 1;
+
+	for (int i = 2; i < last; i += 2) {
+		length += hypot(s->x[i] - s->x[n - 1], s->y[i] - s->y[n - 1]);
+		s->x[n] = s->x[i];
+		s->y[n] = s->y[i];
+		n++;
+	}
+	s->x[n] = s->x[last];
+	s->y[n] = s->y[last];
+	n++;
+
+	s->spacing = MAX(2 * s->spacing, length / (n - 2));
+	s->n = n;
+}
+
 void
 stroke_add_point(struct stroke *s, const double x, const double y)
 {
-	assert(MAX_STROKE_POINTS > s->n);
 	assert(!s->is_finished);
-	s->p[s->n].x = x;
-	s->p[s->n].y = y;
+
+	// The last point is the tip of the stroke.  It is kept only once
+	// it is at least spacing away from its predecessor, otherwise it
+	// is moved to the new position.
+	if (s->n >= 2 && hypot(s->x[s->n - 1] - s->x[s->n - 2],
+	    s->y[s->n - 1] - s->y[s->n - 2]) < s->spacing) {
+		s->x[s->n - 1] = x;
+		s->y[s->n - 1] = y;
+		return;
+	}
+
+	if (s->n == MAX_STROKE_POINTS) {
+		stroke_decimate(s);
+	}
+
+	s->x[s->n] = x;
+	s->y[s->n] = y;
 	s->n++;
 }
 
+static void
+stroke_features(const int points, const stroke_real *t,
+    const stroke_real *alpha, struct stroke_features *f)
+{
+	const int n = points - 1;
+
+	memset(f, 0, sizeof(*f));
+	if (n < 1) {
+		return;
+	}
+
+	for (int i = 0; i < n; i++) {
+		int k = (alpha[i] + 1.0) / 2.0 * STROKE_BINS;
+		k = MAX(0, MIN(k, STROKE_BINS - 1));
+		f->hist[k] += t[i + 1] - t[i];
+	}
+	f->start_alpha = alpha[0];
+	f->start_t = t[1] - t[0];
+	f->end_alpha = alpha[n - 1];
+	f->end_t = t[n] - t[n - 1];
+}
+
+/* Picks points of the normalized stroke that are about equally far apart
+ * along it, at most points of them, and computes t and alpha for them
+ * the same way stroke_finish() does for the whole stroke.
+ */
+static void
+stroke_resample(const struct stroke *s, struct stroke_level *l,
+    const int points)
+{
+	const int n = s->n - 1;
+	double total = 0.0;
+	int keep[STROKE_LEVEL_POINTS];
+	int k = 0;
+
+	if (n < points) {
+		l->n = s->n;
+		for (int i = 0; i < s->n; i++) {
+			l->t[i] = s->t[i];
+			l->alpha[i] = s->alpha[i];
+		}
+		l->features = s->features;
+		return;
+	}
+
+	for (int i = 0; i < n; i++) {
+		total += hypot(s->x[i + 1] - s->x[i], s->y[i + 1] - s->y[i]);
+	}
+
+	const double spacing = total / (points - 1);
+	double length = 0.0;
+	keep[k++] = 0;
+	for (int i = 1; i < n && k < points - 1; i++) {
+		length += hypot(s->x[i] - s->x[i - 1], s->y[i] - s->y[i - 1]);
+		if (length >= k * spacing) {
+			keep[k++] = i;
+		}
+	}
+	keep[k++] = n;
+
+	total = 0.0;
+	for (int i = 0; i < k - 1; i++) {
+		total += hypot(s->x[keep[i + 1]] - s->x[keep[i]],
+		    s->y[keep[i + 1]] - s->y[keep[i]]);
+	}
+
+	length = 0.0;
+	l->t[0] = 0.0;
+	for (int i = 0; i < k - 1; i++) {
+		const double dx = s->x[keep[i + 1]] - s->x[keep[i]];
+		const double dy = s->y[keep[i + 1]] - s->y[keep[i]];
+		length += hypot(dx, dy);
+		l->t[i + 1] = length / total;
+		l->alpha[i] = atan2(dy, dx) / M_PI;
+	}
+	l->alpha[k - 1] = 0.0;
+	l->n = k;
+	stroke_features(l->n, l->t, l->alpha, &l->features);
+}
+
 void
 stroke_finish(struct stroke *s)
 {
@@ -52,24 +174,24 @@ stroke_finish(struct stroke *s)
 
 	const int n = s->n - 1;
 	double total = 0.0;
-	s->p[0].t = 0.0;
 
 	for (int i = 0; i < n; i++) {
-		total += hypot(s->p[i + 1].x - s->p[i].x,
-			s->p[i + 1].y - s->p[i].y);
-		s->p[i + 1].t = total;
+		total += hypot(s->x[i + 1] - s->x[i], s->y[i + 1] - s->y[i]);
 	}
 
-	for (int i = 0; i <= n; i++) {
-		s->p[i].t /= total;
+	double length = 0.0;
+	s->t[0] = 0.0;
+	for (int i = 0; i < n; i++) {
+		length += hypot(s->x[i + 1] - s->x[i], s->y[i + 1] - s->y[i]);
+		s->t[i + 1] = length / total;
 	}
 
-	double minX = s->p[0].x, minY = s->p[0].y, maxX = minX, maxY = minY;
+	double minX = s->x[0], minY = s->y[0], maxX = minX, maxY = minY;
 	for (int i = 1; i <= n; i++) {
-		minX = MIN(s->p[i].x, minX);
-		maxX = MAX(s->p[i].x, maxX);
-		minY = MIN(s->p[i].y, minY);
-		maxY = MAX(s->p[i].y, maxY);
+		minX = MIN(s->x[i], minX);
+		maxX = MAX(s->x[i], maxX);
+		minY = MIN(s->y[i], minY);
+		maxY = MAX(s->y[i], maxY);
 	}
 
 	const double scaleX = maxX - minX;
@@ -79,39 +201,262 @@ stroke_finish(struct stroke *s)
 		scale = 1;
 	}
 	for (int i = 0; i <= n; i++) {
-		s->p[i].x = (s->p[i].x - (minX + maxX) / 2) / scale + 0.5;
-		s->p[i].y = (s->p[i].y - (minY + maxY) / 2) / scale + 0.5;
+		s->x[i] = (s->x[i] - (minX + maxX) / 2) / scale + 0.5;
+		s->y[i] = (s->y[i] - (minY + maxY) / 2) / scale + 0.5;
 	}
 
 	for (int i = 0; i < n; i++) {
-		s->p[i].dt = s->p[i + 1].t - s->p[i].t;
-		s->p[i].alpha =
-		    atan2(s->p[i + 1].y - s->p[i].y,
-			s->p[i + 1].x - s->p[i].x) / M_PI;
+		s->alpha[i] =
+		    atan2(s->y[i + 1] - s->y[i], s->x[i + 1] - s->x[i]) / M_PI;
+	}
+	if (n >= 0) {
+		s->alpha[n] = 0.0;
+	}
+
+	stroke_features(s->n, s->t, s->alpha, &s->features);
+
+	for (int l = 0; l < STROKE_LEVELS; l++) {
+		stroke_resample(s, &s->levels[l], STROKE_LEVEL_POINTS >> 2 * l);
 	}
 }
 
-static double
-angle_difference(const double alpha, const double beta)
+void
+stroke_ws_init(struct stroke_ws *ws)
+{
+	ws->size = 0;
+	ws->used = 0;
+	ws->arena = NULL;
+	ws->visited = 0;
+	ws->pruned = 0;
+}
+
+void
+stroke_ws_free(struct stroke_ws *ws)
+{
+	free(ws->arena);
+	stroke_ws_init(ws);
+}
+
+/* Makes sure the arena holds at least size bytes and returns it.  The
+ * contents are kept when the arena has to grow.
+ */
+static void *
+stroke_ws_reserve(struct stroke_ws *ws, const size_t size)
+{
+	if (size > ws->size) {
+		void *arena = realloc(ws->arena, size);
+		if (arena == NULL) {
+			err(1, "realloc");
+		}
+		ws->arena = arena;
+		ws->size = size;
+	}
+	ws->used = size;
+
+	return (ws->arena);
+}
+
+void
+stroke_get_view(const struct stroke *s, struct stroke_view *v)
+{
+	v->n = s->n;
+	v->t = s->t;
+	v->alpha = s->alpha;
+	v->features = &s->features;
+}
+
+/* Level 0 is the stroke itself, levels 1 to STROKE_LEVELS are the coarser
+ * ones.
+ */
+void
+stroke_get_level_view(const struct stroke *s, const int level,
+    struct stroke_view *v)
+{
+	assert(level >= 0 && level <= STROKE_LEVELS);
+
+	if (level == 0) {
+		stroke_get_view(s, v);
+		return;
+	}
+
+	const struct stroke_level *l = &s->levels[level - 1];
+	v->n = l->n;
+	v->t = l->t;
+	v->alpha = l->alpha;
+	v->features = &l->features;
+}
+
+/* Returns the square of the difference of two angles given in units of
+ * pi.  Computed without branches so that the compiler can turn it into
+ * selects.
+ */
+static inline double
+square_angle_difference(const double alpha, const double beta)
 {
 	double d = alpha - beta;
 
-	if (d < -1.0) {
-		return (d + 2.0);
-	} else if (d > 1.0) {
-		return (d - 2.0);
-	} else {
-		return (d);
+	d += (d < -1.0) ? 2.0 : 0.0;
+	d -= (d > 1.0) ? 2.0 : 0.0;
+
+	return (d * d);
+}
+
+/* Every step has a slope between 1/2.2 and 2.2, so a path can only pass
+ * through (ta, tb) if tb < 2.2 ta and 1 - tb < 2.2 (1 - ta), and vice
+ * versa.  too_early() tells whether tb is too early for ta to satisfy
+ * the vice versa part.  band_slack keeps cells that are only ruled out
+ * by rounding.
+ */
+static const double band_slack = 0.000000001;
+
+static inline int
+too_early(const double ta, const double tb)
+{
+	return (ta >= 2.2 * tb + band_slack ||
+	    1.0 - tb >= 2.2 * (1.0 - ta) + band_slack);
+}
+
+/* The cells of a DP table that a path can pass through.  Row x holds the
+ * cells lo[x] <= y < hi[x], stored from cells[x] on.  The prefix sums of
+ * the steps from row x to row x + 1 cover lo[x] <= y < hi[x + 1] and are
+ * stored from sums[x] on.
+ */
+struct band {
+	int *lo;
+	int *hi;
+	int *cells;
+	int *sums;
+};
+
+/* Both lo and hi only grow with x, so the band is found in a single pass
+ * over a and b.  Returns the number of cells, and the number of prefix
+ * sums in sums.
+ */
+static int
+band_init(struct band *band, const struct stroke_view *a,
+    const struct stroke_view *b, int *sums)
+{
+	const int M = a->n;
+	const int N = b->n;
+	int cells = 0;
+	int lo = 0;
+	int hi = 0;
+
+	for (int x = 0; x < M; x++) {
+		const double ta = a->t[x];
+		while (lo < N && too_early(ta, b->t[lo])) {
+			lo++;
+		}
+		while (hi < N && !too_early(b->t[hi], ta)) {
+			hi++;
+		}
+		band->lo[x] = lo;
+		band->hi[x] = hi;
+		band->cells[x] = cells;
+		cells += MAX(0, hi - lo);
 	}
+
+	*sums = 0;
+	for (int x = 0; x < M - 1; x++) {
+		band->sums[x] = *sums;
+		*sums += MAX(0, band->hi[x + 1] - band->lo[x]);
+	}
+
+	return (cells);
+}
+
+static inline int
+band_contains(const struct band *band, const int x, const int y)
+{
+	return (y >= band->lo[x] && y < band->hi[x]);
 }
 
+static inline int
+band_index(const struct band *band, const int x, const int y)
+{
+	return (band->cells[x] + y - band->lo[x]);
+}
+
+/* State of one stroke_compare_ws() run.  rows is the band of the table
+ * and cols the same band with x and y swapped.  sum_a holds for a's
+ * segment x the integral of the squared angle difference between it and
+ * b from b's point lo[x] to every point of the band, sum_b likewise for
+ * b's segments.  They turn the common steps that span only one segment
+ * of either stroke into two lookups.  prev_x and prev_y are NULL unless
+ * the caller asked for the path.
+ */
+struct dp {
+	const struct stroke_view *a;
+	const struct stroke_view *b;
+	struct band rows;
+	struct band cols;
+	double *dist;
+	int *prev_x;
+	int *prev_y;
+	double *sum_a;
+	double *sum_b;
+	int reach;
+};
+
+/* Points the bands into the start of the arena.
+ */
 static void
-step(const struct stroke *a, const struct stroke *b, const int N, double *dist,
-     int *prev_x, int *prev_y, const int x, const int y, const double tx,
+dp_layout(struct dp *dp, void *arena, const int M, const int N)
+{
+	dp->rows.lo = arena;
+	dp->rows.hi = dp->rows.lo + M;
+	dp->rows.cells = dp->rows.hi + M;
+	dp->rows.sums = dp->rows.cells + M;
+	dp->cols.lo = dp->rows.sums + M;
+	dp->cols.hi = dp->cols.lo + N;
+	dp->cols.cells = dp->cols.hi + N;
+	dp->cols.sums = dp->cols.cells + N;
+}
+
+static void
+prefix_sums(const struct stroke_view *a, const struct stroke_view *b,
+    const struct band *band, double *sum)
+{
+	for (int x = 0; x < a->n - 1; x++) {
+		const int lo = band->lo[x];
+		const int hi = band->hi[x + 1];
+		double *row = &sum[band->sums[x]];
+		const double alpha = a->alpha[x];
+
+		if (hi <= lo) {
+			continue;
+		}
+
+		// The products are independent of each other, this loop is
+		// left to the compiler to vectorize.
+		row[0] = 0.0;
+		for (int j = lo; j < hi - 1; j++) {
+			row[j - lo + 1] = (b->t[j + 1] - b->t[j]) *
+			    square_angle_difference(alpha, b->alpha[j]);
+		}
+		for (int j = 1; j < hi - lo; j++) {
+			row[j] += row[j - 1];
+		}
+	}
+}
+
+static inline double
+prefix_sum_difference(const struct band *band, const double *sum,
+    const int x, const int from, const int to)
+{
+	const int row = band->sums[x] - band->lo[x];
+
+	return (sum[row + to] - sum[row + from]);
+}
+
+static void
+step(struct dp *dp, const int x, const int y, const double tx,
      const double ty, int *k, const int x2, const int y2)
 {
-	const double dtx = a->p[x2].t - tx;
-	const double dty = b->p[y2].t - ty;
+	const struct stroke_view *a = dp->a;
+	const struct stroke_view *b = dp->b;
+	const double dtx = a->t[x2] - tx;
+	const double dty = b->t[y2] - ty;
 
 	if ((dtx >= dty * 2.2) || (dty >= dtx * 2.2) || (dtx < epsilon) ||
 	    (dty < epsilon)) {
@@ -119,40 +464,134 @@ step(const struct stroke *a, const struct stroke *b, const int N, double *dist,
 	}
 	(*k)++;
 
+	// No complete path passes through cells outside of the band
+	if (!band_contains(&dp->rows, x2, y2)) {
+		return;
+	}
+
 	double d = 0.0;
-	int i = x, j = y;
-	double next_tx = (a->p[i + 1].t - tx) / dtx;
-	double next_ty = (b->p[j + 1].t - ty) / dty;
-	double cur_t = 0.0;
-
-	while (1) {
-		const double ad =
-		    pow(angle_difference(a->p[i].alpha, b->p[j].alpha), 2);
-		double next_t = next_tx < next_ty ? next_tx : next_ty;
-		const int done = next_t >= 1.0 - epsilon;
-		if (done) {
-			next_t = 1.0;
+	if (x2 == x + 1) {
+		d = prefix_sum_difference(&dp->rows, dp->sum_a, x, y, y2) /
+		    dty;
+	} else if (y2 == y + 1) {
+		d = prefix_sum_difference(&dp->cols, dp->sum_b, y, x, x2) /
+		    dtx;
+	} else {
+		int i = x, j = y;
+		double next_tx = (a->t[i + 1] - tx) / dtx;
+		double next_ty = (b->t[j + 1] - ty) / dty;
+		double cur_t = 0.0;
+
+		while (1) {
+			const double ad = square_angle_difference(a->alpha[i],
+			    b->alpha[j]);
+			double next_t = next_tx < next_ty ? next_tx : next_ty;
+			const int done = next_t >= 1.0 - epsilon;
+			if (done) {
+				next_t = 1.0;
+			}
+			d += (next_t - cur_t) * ad;
+			if (done) {
+				break;
+			}
+			cur_t = next_t;
+			if (next_tx < next_ty) {
+				next_tx = (a->t[++i + 1] - tx) / dtx;
+			} else {
+				next_ty = (b->t[++j + 1] - ty) / dty;
+			}
 		}
-		d += (next_t - cur_t) * ad;
-		if (done) {
-			break;
+	}
+
+	const int from = band_index(&dp->rows, x, y);
+	const int to = band_index(&dp->rows, x2, y2);
+	const double new_dist = dp->dist[from] + d * (dtx + dty);
+	if (new_dist >= dp->dist[to]) {
+		return;
+	}
+
+	if (dp->prev_x) {
+		dp->prev_x[to] = x;
+		dp->prev_y[to] = y;
+	}
+	dp->dist[to] = new_dist;
+	dp->reach = MAX(dp->reach, x2);
+}
+
+/* The lower bounds below rest on two facts about stroke_compare()'s cost.
+ * First, it is the integral of the squared angle difference over a's t
+ * plus the same integral over b's t.  Second, every step has a slope
+ * between 1/2.2 and 2.2, so wherever a path is at (ta, tb), tb < 2.2 ta
+ * and 1 - tb < 2.2 (1 - ta) hold, and vice versa.  Rounding and the
+ * epsilon in step() can make the DP a little cheaper than the exact
+ * integral, which bound_slack makes up for.
+ */
+static const double bound_slack = 0.00001;
+
+/* The beginning of a's first segment can only be aligned with b's first
+ * segment, at least up to t = b's start_t / 2.2.  The same holds for the
+ * ends.  Both regions may overlap, so only the larger bound is used.
+ */
+double
+stroke_lower_bound_ends(const struct stroke_view *a,
+    const struct stroke_view *b)
+{
+	const struct stroke_features *fa = a->features;
+	const struct stroke_features *fb = b->features;
+
+	if (fa == NULL || fb == NULL) {
+		return (0.0);
+	}
+
+	const double start = (MIN(fa->start_t, fb->start_t / 2.2) +
+	    MIN(fb->start_t, fa->start_t / 2.2)) *
+	    square_angle_difference(fa->start_alpha, fb->start_alpha);
+	const double end = (MIN(fa->end_t, fb->end_t / 2.2) +
+	    MIN(fb->end_t, fa->end_t / 2.2)) *
+	    square_angle_difference(fa->end_alpha, fb->end_alpha);
+
+	return (MAX(start, end) - bound_slack);
+}
+
+/* Every part of a is aligned with some direction of b, so it costs at
+ * least the squared distance to the closest direction bin in which b has
+ * any length, and vice versa.
+ */
+static double
+hist_bound(const struct stroke_features *fa, const struct stroke_features *fb)
+{
+	const double width = 2.0 / STROKE_BINS;
+	double bound = 0.0;
+
+	for (int k = 0; k < STROKE_BINS; k++) {
+		if (fa->hist[k] <= 0.0) {
+			continue;
 		}
-		cur_t = next_t;
-		if (next_tx < next_ty) {
-			next_tx = (a->p[++i + 1].t - tx) / dtx;
-		} else {
-			next_ty = (b->p[++j + 1].t - ty) / dty;
+		int gap = STROKE_BINS;
+		for (int l = 0; l < STROKE_BINS; l++) {
+			if (fb->hist[l] > 0.0) {
+				const int d = abs(k - l);
+				gap = MIN(gap, MIN(d, STROKE_BINS - d));
+			}
 		}
+		// Angles in neighbouring bins can be arbitrarily close
+		const double angle = MAX(0, gap - 1) * width;
+		bound += fa->hist[k] * angle * angle;
 	}
 
-	const double new_dist = dist[x * N + y] + d * (dtx + dty);
-	if (new_dist >= dist[x2 * N + y2]) {
-		return;
+	return (bound);
+}
+
+double
+stroke_lower_bound_hist(const struct stroke_view *a,
+    const struct stroke_view *b)
+{
+	if (a->features == NULL || b->features == NULL) {
+		return (0.0);
 	}
 
-	prev_x[x2 * N + y2] = x;
-	prev_y[x2 * N + y2] = y;
-	dist[x2 * N + y2] = new_dist;
+	return (hist_bound(a->features, b->features) +
+	    hist_bound(b->features, a->features) - bound_slack);
 }
 
 /* To compare two gestures, we use dynamic programming to minimize (an
@@ -162,84 +601,154 @@ step(const struct stroke *a, const struct stroke *b, const int N, double *dist,
 double
 stroke_compare(const struct stroke *a, const struct stroke *b, int *path_x, int *path_y)
 {
+	struct stroke_ws ws;
+	struct stroke_view va, vb;
+
+	stroke_get_view(a, &va);
+	stroke_get_view(b, &vb);
+	stroke_ws_init(&ws);
+	const double cost = stroke_compare_ws(&ws, &va, &vb, path_x, path_y);
+	stroke_ws_free(&ws);
+
+	return (cost);
+}
+
+double
+stroke_compare_ws(struct stroke_ws *ws, const struct stroke_view *a,
+    const struct stroke_view *b, int *path_x, int *path_y)
+{
+	return (stroke_compare_bounded(ws, a, b, stroke_infinity, path_x,
+	    path_y));
+}
+
+/* Like stroke_compare_ws(), but only looks for costs below bound.  Costs
+ * only grow along a path, so cells that already cost bound are dropped,
+ * and the DP stops as soon as no cell below bound is left.  Returns bound
+ * if there is no cheaper alignment.
+ */
+double
+stroke_compare_bounded(struct stroke_ws *ws, const struct stroke_view *a,
+    const struct stroke_view *b, double bound, int *path_x, int *path_y)
+{
+	assert(ws);
 	assert(a);
 	assert(b);
 
+	bound = MIN(bound, stroke_infinity);
+
 	const int M = a->n;
 	const int N = b->n;
 	const int m = M - 1;
 	const int n = N - 1;
+	struct dp dp;
 
-	double dist[M * N];
-	int prev_x[M * N];
-	int prev_y[M * N];
+	dp.a = a;
+	dp.b = b;
+	dp.reach = 0;
 
-	memset(prev_x, 0, M * N);
-	memset(prev_y, 0, M * N);
+	// The band goes first, its size determines how large the tables
+	// after it are
+	const size_t band_size = roundup(4 * (M + N) * sizeof(int),
+	    sizeof(double));
+	int nsum_a, nsum_b;
+	dp_layout(&dp, stroke_ws_reserve(ws, band_size), M, N);
+	const int cells = band_init(&dp.rows, a, b, &nsum_a);
+	band_init(&dp.cols, b, a, &nsum_b);
 
-	for (int i = 0; i < m; i++) {
-		for (int j = 0; j < n; j++) {
-			dist[i * N + j] = stroke_infinity;
-		}
+	// The back pointers are only needed to reconstruct the path
+	const int with_path = path_x && path_y;
+	char *arena = stroke_ws_reserve(ws, band_size +
+	    (cells + nsum_a + nsum_b) * sizeof(double) +
+	    (with_path ? 2 * cells * sizeof(int) : 0));
+	dp_layout(&dp, arena, M, N);
+	dp.dist = (double *)(arena + band_size);
+	dp.sum_a = dp.dist + cells;
+	dp.sum_b = dp.sum_a + nsum_a;
+	dp.prev_x = NULL;
+	dp.prev_y = NULL;
+	if (with_path) {
+		dp.prev_x = (int *)(dp.sum_b + nsum_b);
+		dp.prev_y = dp.prev_x + cells;
+		memset(dp.prev_x, 0, cells * sizeof(int));
+		memset(dp.prev_y, 0, cells * sizeof(int));
 	}
-	dist[M * N - 1] = stroke_infinity;
-	dist[0] = 0.0;
 
-	for (int x = 0; x < m; x++) {
-		for (int y = 0; y < n; y++) {
-			if (dist[x * N + y] >= stroke_infinity) {
+	prefix_sums(a, b, &dp.rows, dp.sum_a);
+	prefix_sums(b, a, &dp.cols, dp.sum_b);
+
+	double *dist = dp.dist;
+	for (int i = 0; i < cells; i++) {
+		dist[i] = bound;
+	}
+	if (band_contains(&dp.rows, 0, 0)) {
+		dist[band_index(&dp.rows, 0, 0)] = 0.0;
+	}
+
+	// Steps always advance x, so once x is past the last row with a
+	// cell below bound nothing can improve anymore
+	unsigned long visited = 0;
+	unsigned long pruned = 0;
+	for (int x = 0; x < m && x <= dp.reach; x++) {
+		const int last = MIN(dp.rows.hi[x], n);
+		for (int y = dp.rows.lo[x]; y < last; y++) {
+			if (dist[band_index(&dp.rows, x, y)] >= bound) {
+				pruned++;
 				continue;
 			}
-			const double tx = a->p[x].t;
-			const double ty = b->p[y].t;
+			visited++;
+			const double tx = a->t[x];
+			const double ty = b->t[y];
 			int max_x = x;
 			int max_y = y;
 			int k = 0;
 
 			while (k < 4) {
-				if (a->p[max_x + 1].t - tx >
-				    b->p[max_y + 1].t - ty) {
+				if (a->t[max_x + 1] - tx >
+				    b->t[max_y + 1] - ty) {
 					max_y++;
 					if (max_y == n) {
-						step(a, b, N, dist, prev_x,
-						    prev_y, x, y, tx, ty, &k,
+						step(&dp, x, y, tx, ty, &k,
 						    m, n);
 						break;
 					}
 					for (int x2 = x + 1; x2 <= max_x;
 					    x2++) {
-						step(a, b, N, dist, prev_x,
-						    prev_y, x, y, tx, ty, &k,
+						step(&dp, x, y, tx, ty, &k,
 						    x2, max_y);
 					}
 				} else {
 					max_x++;
 					if (max_x == m) {
-						step(a, b, N, dist, prev_x,
-						     prev_y, x, y, tx, ty, &k,
+						step(&dp, x, y, tx, ty, &k,
 						     m, n);
 						break;
 					}
 					for (int y2 = y + 1; y2 <= max_y;
 					    y2++) {
-						step(a, b, N, dist, prev_x,
-						     prev_y, x, y, tx, ty, &k,
+						step(&dp, x, y, tx, ty, &k,
 						     max_x, y2);
 					}
 				}
 			}
 		}
 	}
-	const double cost = dist[M * N - 1];
-	if (path_x && path_y) {
-		if (cost < stroke_infinity) {
+	for (int x = dp.reach + 1; x < m; x++) {
+		pruned += MAX(0, MIN(dp.rows.hi[x], n) - dp.rows.lo[x]);
+	}
+	ws->visited += visited;
+	ws->pruned += pruned;
+
+	const double cost = band_contains(&dp.rows, m, n) ?
+	    dist[band_index(&dp.rows, m, n)] : bound;
+	if (with_path) {
+		if (cost < bound) {
 			int x = m;
 			int y = n;
 			int k = 0;
 			while (x || y) {
-				const int old_x = x;
-				x = prev_x[x * N + y];
-				y = prev_y[old_x * N + y];
+				const int i = band_index(&dp.rows, x, y);
+				x = dp.prev_x[i];
+				y = dp.prev_y[i];
 				path_x[k] = x;
 				path_y[k] = y;
 				k++;
@@ -17,27 +17,123 @@
 #ifndef __STROKE_H__
 #define __STROKE_H__
 
+#include <stddef.h>
+
 #ifndef MAX_STROKE_POINTS
 #define MAX_STROKE_POINTS    512
 #endif
 
-struct point {
-	double x;
-	double y;
-	double t;
-	double dt;
-	double alpha;
+/* Define STROKE_FLOAT to 1 to store t and alpha as floats, which halves
+ * the memory read by stroke_compare().  The DP itself uses doubles.
+ */
+#ifndef STROKE_FLOAT
+#define STROKE_FLOAT    0
+#endif
+
+#if STROKE_FLOAT
+typedef float stroke_real;
+#else
+typedef double stroke_real;
+#endif
+
+#define STROKE_BINS	16
+
+/* Cheap summaries of a finished stroke that give lower bounds of
+ * stroke_compare()'s cost.  hist[k] is the part of the stroke (in t)
+ * whose direction falls into the k-th of STROKE_BINS equal slices of the
+ * full circle.  start and end are the direction and t-length of the
+ * first and last segment.
+ */
+struct stroke_features {
+	double hist[STROKE_BINS];
+	double start_alpha;
+	double start_t;
+	double end_alpha;
+	double end_t;
+};
+
+/* stroke_finish() also resamples the stroke to STROKE_LEVELS coarser
+ * levels.  Level l (counting from 1) has at most STROKE_LEVEL_POINTS >>
+ * 2 (l - 1) points, i.e. 64 and 16, which makes comparing against it
+ * cheap enough to rank many templates before comparing the best ones at
+ * full resolution.
+ */
+#define STROKE_LEVELS		2
+#define STROKE_LEVEL_POINTS	64
+
+struct stroke_level {
+	int n;
+	stroke_real t[STROKE_LEVEL_POINTS];
+	stroke_real alpha[STROKE_LEVEL_POINTS];
+	struct stroke_features features;
 };
 
+/* Strokes never hold more than MAX_STROKE_POINTS points.  Once the buffer
+ * fills up every other point is dropped and the minimum distance between
+ * consecutive points is raised accordingly, so arbitrarily long or fast
+ * strokes are resampled while they are being captured.
+ *
+ * The points are stored as separate arrays.  stroke_compare() only reads
+ * t and alpha, so it does not have to drag x and y through the cache.
+ */
 struct stroke {
 	int n;
 	int is_finished;
-	struct point p[MAX_STROKE_POINTS];
+	double spacing;
+	double x[MAX_STROKE_POINTS];
+	double y[MAX_STROKE_POINTS];
+	stroke_real t[MAX_STROKE_POINTS];
+	stroke_real alpha[MAX_STROKE_POINTS];
+	struct stroke_features features;
+	struct stroke_level levels[STROKE_LEVELS];
+};
+
+/* A borrowed, read-only view of the t and alpha values of a finished
+ * stroke.  It can point into a struct stroke as well as into the flat
+ * arrays of a template pool.
+ */
+struct stroke_view {
+	int n;
+	const stroke_real *t;
+	const stroke_real *alpha;
+	const struct stroke_features *features;
+};
+
+/* Scratch memory for stroke_compare_ws().  The DP tables are carved out
+ * of a single arena that is grown on demand and reused across calls, so
+ * comparing against many templates does not allocate per call.  used is
+ * the part of the arena that the last comparison needed.
+ *
+ * visited and pruned add up over all comparisons until the caller resets
+ * them.  visited counts the DP cells that were expanded, pruned the
+ * cells of the band that were skipped because their cost had already
+ * reached the bound, i.e. stroke_infinity or the caller's.
+ */
+struct stroke_ws {
+	size_t size;
+	size_t used;
+	void *arena;
+	unsigned long visited;
+	unsigned long pruned;
 };
 
+void stroke_ws_init(struct stroke_ws *);
+void stroke_ws_free(struct stroke_ws *);
+
 void stroke_add_point(struct stroke *, double, double);
 void stroke_finish(struct stroke *);
 double stroke_compare(const struct stroke *, const struct stroke *, int *, int *);
+double stroke_compare_ws(struct stroke_ws *, const struct stroke_view *,
+    const struct stroke_view *, int *, int *);
+double stroke_compare_bounded(struct stroke_ws *, const struct stroke_view *,
+    const struct stroke_view *, double, int *, int *);
+void stroke_get_view(const struct stroke *, struct stroke_view *);
+void stroke_get_level_view(const struct stroke *, int,
+    struct stroke_view *);
+double stroke_lower_bound_ends(const struct stroke_view *,
+    const struct stroke_view *);
+double stroke_lower_bound_hist(const struct stroke_view *,
+    const struct stroke_view *);
 
 extern const double stroke_infinity;
 
@@ -20,51 +20,122 @@
 # include <err.h>
 #endif
 #include <sys/wait.h>
+#include <string.h>
 #include <unistd.h>
 
+#include "stroke.h"
+#include "timing.h"
 #include "tracker.h"
 
 static const char *command;
+static struct tracker_stats stats;
+static int idle_timeout = -1;
+static tracker_idle_handler idle_handler;
+static void *idle_arg;
+static const char *replay_path;
+static int replay_realtime;
+static int keep_fd = -1;
 static void tracker_run_command_internal(void);
 
 #if HAVE_EVDEV
 #include "tracker_evdev.c"
+#include "tracker_replay.c"
 #endif
 
+// Makes the tracker read recorded events from path, or stdin if it is
+// "-", instead of the mouse.  Has to be called before tracker_init().
 void
-tracker_init(const char *command_)
+tracker_set_replay(const char *path, int realtime)
+{
+	replay_path = path;
+	replay_realtime = realtime;
+}
+
+// Keeps fd open when tracker_init() enters the sandbox, which closes all
+// other descriptors but the standard ones.  Has to be called before
+// tracker_init().
+void
+tracker_keep_fd(int fd)
+{
+	keep_fd = fd;
+}
+
+void
+tracker_init(const char *command_, int flags)
 {
 	command = command_;
 
 #if HAVE_EVDEV
-	if (!evdev_init())
+	if (!(replay_path != NULL ? replay_init(flags) : evdev_init(flags)))
 #endif
 		errx(1, "failed to initialize mouse tracker");
 }
 
+// Lets the caller work on the stroke, e.g. match it speculatively, in
+// the pauses of at least timeout milliseconds while it is being drawn.
+// The handler is called at most once per pause.
+void
+tracker_set_idle_handler(int timeout, tracker_idle_handler handler,
+    void *arg)
+{
+	idle_timeout = handler != NULL ? timeout : -1;
+	idle_handler = handler;
+	idle_arg = arg;
+}
+
 int
 tracker_record_stroke(struct stroke *stroke)
 {
+	const double start = timing_now();
+
 	if (stroke != NULL) {
 		memset(stroke, 0, sizeof(struct stroke));
 	}
 
 #if HAVE_EVDEV
-	if (!evdev_record_stroke(stroke))
+	if (!(replay_path != NULL ? replay_record_stroke(stroke) :
+	    evdev_record_stroke(stroke)))
 #endif
 		return 0;
 
+	const double end = timing_now();
+	if (stroke != NULL) {
+		stroke_finish(stroke);
+	}
+	stats.capture = end - start;
+	stats.finish = timing_now() - end;
+
 	return 1;
 }
 
+// Discards all pending input, so that the next stroke starts fresh.
+// Recorded events are never pending, they are replayed in order.
+void
+tracker_flush()
+{
+#if HAVE_EVDEV
+	if (replay_path == NULL) {
+		evdev_flush();
+	}
+#endif
+}
+
+const struct tracker_stats *
+tracker_stats()
+{
+	return &stats;
+}
+
 void
 tracker_run_command()
 {
 #if HAVE_CAPSICUM && HAVE_EVDEV
-	evdev_run_command();
-#else
-	tracker_run_command_internal();
+	if (replay_path == NULL) {
+		evdev_run_command();
+		return;
+	}
 #endif
+	tracker_run_command_internal();
 }
 
 static
@@ -18,8 +18,31 @@
 
 struct stroke;
 
-void tracker_init(const char *);
+// Counters of the last tracker_record_stroke() call.  capture is the
+// time in seconds from the call until the stroke ended, finish the part
+// of it that stroke_finish() took.
+struct tracker_stats {
+	unsigned long syscalls;
+	unsigned long events;
+	unsigned long idle;
+	double capture;
+	double finish;
+};
+
+// Called with the unfinished stroke whenever the pointer has not moved
+// for the idle timeout while a stroke is being recorded
+typedef void (*tracker_idle_handler)(const struct stroke *, void *);
+
+// Keep stdin open for reading, e.g. for the daemon mode's triggers
+#define TRACKER_KEEP_STDIN	0x1
+
+void tracker_set_replay(const char *, int);
+void tracker_keep_fd(int);
+void tracker_init(const char *, int);
+void tracker_set_idle_handler(int, tracker_idle_handler, void *);
 int tracker_record_stroke(/* out */ struct stroke *stroke);
 void tracker_run_command(void);
+void tracker_flush(void);
+const struct tracker_stats *tracker_stats(void);
 
 #endif
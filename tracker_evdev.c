@@ -54,6 +54,20 @@
 
 static struct pollfd fds[32];
 static size_t nfds;
+// Relative motion of the current, not yet reported, evdev frame of
+// each device
+static struct {
+	int dx;
+	int dy;
+	int dropped;
+} frames[nitems(fds)];
+// Events that were read from each device but not handled yet, because
+// an earlier event of the same read(2) ended the stroke
+static struct {
+	struct input_event evs[64];
+	size_t head;
+	size_t tail;
+} pending[nitems(fds)];
 static int props_by_sysctl = 0;
 #if HAVE_CAPSICUM
 static int command_runner_fd[2] = { -1, -1 };
@@ -209,12 +223,34 @@ evdev_run_command(void)
 #endif
 
 
+#if HAVE_CAPSICUM
+// Like closefrom(), but leaves keep_fd open
+static void
+evdev_closefrom(int lowfd)
+{
+	if (keep_fd < lowfd) {
+		closefrom(lowfd);
+		return;
+	}
+	for (int fd = lowfd; fd < keep_fd; fd++) {
+		close(fd);
+	}
+	closefrom(keep_fd + 1);
+}
+#endif
+
 static int
-evdev_init(void)
+evdev_init(int flags)
 {
 #if HAVE_CAPSICUM
-	close(STDIN_FILENO);
-	closefrom(STDERR_FILENO + 1);
+	if (flags & TRACKER_KEEP_STDIN) {
+		if (caph_limit_stdin() < 0) {
+			err(1, "caph_limit_stdin");
+		}
+	} else {
+		close(STDIN_FILENO);
+	}
+	evdev_closefrom(STDERR_FILENO + 1);
 
 	if (command != NULL) {
 		evdev_create_command_runner();
@@ -270,7 +306,7 @@ evdev_init(void)
 	}
 
 #if HAVE_CAPSICUM
-	closefrom(maxfd + 1);
+	evdev_closefrom(maxfd + 1);
 
 	if (caph_enter() < 0) {
 		err(1, "cap_enter");
@@ -280,40 +316,139 @@ evdev_init(void)
 	return 1;
 }
 
+static void
+evdev_flush(void)
+{
+	struct input_event evs[64];
+
+	for (size_t i = 0; i < nfds; i++) {
+		pending[i].head = 0;
+		pending[i].tail = 0;
+		while (read(fds[i].fd, evs, sizeof(evs)) > 0);
+	}
+}
+
+// Adds the motion accumulated in a frame to the stroke as a single point
+static void
+evdev_flush_frame(size_t i, double *x, double *y, struct stroke *stroke)
+{
+	if (!frames[i].dropped && (frames[i].dx != 0 || frames[i].dy != 0)) {
+		*x += frames[i].dx;
+		*y += frames[i].dy;
+		stroke_add_point(stroke, *x, *y);
+	}
+	frames[i].dx = 0;
+	frames[i].dy = 0;
+}
+
+// Returns 0 once ev ends the stroke
+static int
+evdev_handle_event(size_t i, const struct input_event *ev, double *x,
+    double *y, struct stroke *stroke)
+{
+	if (ev->type == EV_KEY) {
+		if (stroke != NULL) {
+			evdev_flush_frame(i, x, y, stroke);
+		}
+		return 0;
+	} else if (stroke == NULL) {
+		return 1;
+	}
+
+	// Coalesce all motion of one frame into one point.  Frames after
+	// SYN_DROPPED are incomplete and are skipped up to the next
+	// SYN_REPORT.
+	if (ev->type == EV_REL) {
+		switch (ev->code) {
+			case REL_X:
+				frames[i].dx += ev->value;
+				break;
+			case REL_Y:
+				frames[i].dy += ev->value;
+				break;
+		}
+	} else if (ev->type == EV_SYN) {
+		switch (ev->code) {
+			case SYN_REPORT:
+				evdev_flush_frame(i, x, y, stroke);
+				frames[i].dropped = 0;
+				break;
+			case SYN_DROPPED:
+				frames[i].dropped = 1;
+				break;
+		}
+	}
+
+	return 1;
+}
+
+// Handles the pending events of device i.  Returns 0 if one of them
+// ended the stroke, the events after it stay pending.
+static int
+evdev_handle_pending(size_t i, double *x, double *y, struct stroke *stroke)
+{
+	while (pending[i].head < pending[i].tail) {
+		stats.events++;
+		if (!evdev_handle_event(i, &pending[i].evs[pending[i].head++],
+		    x, y, stroke)) {
+			return 0;
+		}
+	}
+
+	return 1;
+}
+
 static int
 evdev_record_stroke(/* out */ struct stroke *stroke)
 {
 	double x = 0.0;
 	double y = 0.0;
-	while (poll(fds, nfds, -1) > -1) {
+	memset(frames, 0, sizeof(frames));
+	memset(&stats, 0, sizeof(stats));
+	// What the last call did not handle comes first, e.g. the motion
+	// right after the button press that the last call waited for
+	for (size_t i = 0; i < nfds; i++) {
+		if (!evdev_handle_pending(i, &x, &y, stroke)) {
+			return 1;
+		}
+	}
+	// Only wait for a pause if the handler has not seen the stroke
+	// as it is now
+	const int speculate = stroke != NULL && idle_handler != NULL;
+	int idle = !speculate;
+	int ready;
+	while ((ready = poll(fds, nfds, idle ? -1 : idle_timeout)) > -1) {
+		stats.syscalls++;
+		if (ready == 0) {
+			idle = 1;
+			if (stroke->n >= 2) {
+				stats.idle++;
+				idle_handler(stroke, idle_arg);
+			}
+			continue;
+		}
+		idle = !speculate;
 		for (size_t i = 0; i < nfds; i++) {
-			struct input_event ev;
 			if ((fds[i].revents & POLLHUP) ||
 			    (fds[i].revents & POLLIN) == 0) {
 				continue;
 			}
-			while (read(fds[i].fd, &ev, sizeof(struct input_event)) > 0) {
-				if (stroke != NULL && ev.type == EV_REL) {
-					switch (ev.code) {
-						case REL_X:
-							x += ev.value;
-							break;
-						case REL_Y:
-							y += ev.value;
-							break;
-					}
-					stroke_add_point(stroke, x, y);
-				} else if (ev.type == EV_KEY) {
-					goto end;
+			// Drain each device with as few read(2) calls as
+			// possible
+			ssize_t len;
+			while ((len = read(fds[i].fd, pending[i].evs,
+			    sizeof(pending[i].evs))) > 0) {
+				stats.syscalls++;
+				pending[i].head = 0;
+				pending[i].tail = len /
+				    sizeof(pending[i].evs[0]);
+				if (!evdev_handle_pending(i, &x, &y, stroke)) {
+					return 1;
 				}
 			}
+			stats.syscalls++;
 		}
 	}
 
-end:
-	if (stroke != NULL) {
-		stroke_finish(stroke);
-	}
-
 	return 1;
 }
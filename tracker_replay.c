@@ -0,0 +1,212 @@
+/*
+ * Copyright (c) 2020 Tobias Kortkamp <t@tobik.me>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION
+ * OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+// Replays recorded input events from a file instead of reading them from
+// the mouse.  This is included by tracker.c after tracker_evdev.c and
+// feeds the events through the same evdev_handle_event().
+//
+// Both raw dumps of struct input_event, e.g. from cat /dev/input/eventN,
+// and the text format of evemu-record(1) are read.  A file is taken as
+// evemu text if it starts with the "# EVEMU" header that evemu-record(1)
+// writes.  Only one device per file is supported.
+
+#define REPLAY_EVEMU_HEADER	"# EVEMU"
+
+static FILE *replay_fp;
+static int replay_evemu;
+// The first bytes of the file, which were read to tell the format and
+// are handed out again before reading on
+static char replay_head[sizeof(REPLAY_EVEMU_HEADER) - 1];
+static size_t replay_nhead;
+static size_t replay_head_used;
+static size_t replay_events;
+static int replay_eof;
+
+static int
+replay_init(int flags)
+{
+	if (strcmp(replay_path, "-") == 0) {
+		if (flags & TRACKER_KEEP_STDIN) {
+			warnx("replay: stdin is already used");
+			return 0;
+		}
+		replay_fp = stdin;
+	} else if ((replay_fp = fopen(replay_path, "r")) == NULL) {
+		warn("replay: %s", replay_path);
+		return 0;
+	}
+
+	// stdin may be a pipe, so the bytes cannot be put back
+	replay_nhead = fread(replay_head, 1, sizeof(replay_head), replay_fp);
+	replay_head_used = 0;
+	replay_evemu = replay_nhead == sizeof(replay_head) &&
+	    memcmp(replay_head, REPLAY_EVEMU_HEADER, sizeof(replay_head)) == 0;
+	replay_events = 0;
+	replay_eof = 0;
+
+	return 1;
+}
+
+// fread() and fgets() that return what is left of replay_head first
+static size_t
+replay_fread(void *buf, size_t size)
+{
+	char *p = buf;
+	size_t n = 0;
+
+	while (n < size && replay_head_used < replay_nhead) {
+		p[n++] = replay_head[replay_head_used++];
+	}
+	return n + fread(p + n, 1, size - n, replay_fp);
+}
+
+static char *
+replay_fgets(char *line, size_t size)
+{
+	size_t n = 0;
+
+	while (n + 1 < size && replay_head_used < replay_nhead) {
+		line[n++] = replay_head[replay_head_used++];
+		if (line[n - 1] == '\n') {
+			line[n] = '\0';
+			return line;
+		}
+	}
+	if (fgets(line + n, size - n, replay_fp) == NULL) {
+		if (n == 0) {
+			return NULL;
+		}
+		line[n] = '\0';
+	}
+	return line;
+}
+
+// Warns once at the end of the file if it held no events at all, so
+// that a file in the wrong format does not go unnoticed
+static int
+replay_end(void)
+{
+	if (!replay_eof && replay_events == 0) {
+		warnx("replay: %s: no input events found", replay_path);
+	}
+	replay_eof = 1;
+	return 0;
+}
+
+// Reads the next event and its time in seconds.  Returns 0 at the end of
+// the file.
+static int
+replay_read(struct input_event *ev, double *t)
+{
+	if (replay_eof) {
+		return 0;
+	}
+	if (!replay_evemu) {
+		size_t n = replay_fread(ev, sizeof(*ev));
+		if (n != sizeof(*ev)) {
+			if (ferror(replay_fp)) {
+				err(1, "replay: %s", replay_path);
+			}
+			if (n > 0) {
+				warnx("replay: %s: %zu trailing bytes, not "
+				    "a raw event dump?", replay_path, n);
+			}
+			return replay_end();
+		}
+		replay_events++;
+		*t = ev->input_event_sec + ev->input_event_usec / 1e6;
+		return 1;
+	}
+
+	// E: <sec>.<usec> <type> <code> <value>, type and code in hex
+	char line[256];
+	while (replay_fgets(line, sizeof(line)) != NULL) {
+		long sec, usec;
+		unsigned int type, code;
+		int value;
+		if (sscanf(line, "E: %ld.%ld %x %x %d", &sec, &usec, &type,
+		    &code, &value) != 5) {
+			continue;
+		}
+		memset(ev, 0, sizeof(*ev));
+		ev->input_event_sec = sec;
+		ev->input_event_usec = usec;
+		ev->type = type;
+		ev->code = code;
+		ev->value = value;
+		replay_events++;
+		*t = sec + usec / 1e6;
+		return 1;
+	}
+	if (ferror(replay_fp)) {
+		err(1, "replay: %s", replay_path);
+	}
+
+	return replay_end();
+}
+
+// Like evdev_record_stroke(), but a pause in the recording takes the place
+// of poll(2) timing out.  With replay_realtime the events are delivered
+// at their original pace, relative to the first event of the stroke,
+// otherwise as fast as possible.
+static int
+replay_record_stroke(struct stroke *stroke)
+{
+	struct input_event ev;
+	double x = 0.0;
+	double y = 0.0;
+	double t, first_t = 0.0, last_t = 0.0;
+	double start = 0.0;
+	memset(frames, 0, sizeof(frames));
+	memset(&stats, 0, sizeof(stats));
+	while (replay_read(&ev, &t)) {
+		stats.events++;
+		if (stats.events == 1) {
+			first_t = t;
+			start = timing_now();
+		} else if (stroke != NULL && idle_handler != NULL &&
+		    stroke->n >= 2 && (t - last_t) * 1000 >= idle_timeout) {
+			if (replay_realtime) {
+				timing_sleep_until(start + last_t - first_t +
+				    idle_timeout / 1000.0);
+			}
+			stats.idle++;
+			idle_handler(stroke, idle_arg);
+		}
+		last_t = t;
+		if (replay_realtime) {
+			timing_sleep_until(start + t - first_t);
+		}
+
+		// Recordings usually start with the button press that the
+		// stroke is drawn with
+		if (stroke != NULL && ev.type == EV_KEY && ev.value != 0) {
+			continue;
+		}
+		if (!evdev_handle_event(0, &ev, &x, &y, stroke)) {
+			return 1;
+		}
+	}
+
+	// A stroke cut off by the end of the recording still counts
+	if (stroke != NULL && (stroke->n > 0 || frames[0].dx != 0 ||
+	    frames[0].dy != 0)) {
+		evdev_flush_frame(0, &x, &y, stroke);
+		return 1;
+	}
+
+	return 0;
+}